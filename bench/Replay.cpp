@@ -0,0 +1,697 @@
+/**
+ * @file Replay.cpp
+ *
+ * Replay benchmark: feeds a captured NMEA log through the firmware's
+ * receive, parse and display path on the host and reports the throughput
+ * of receiving and parsing, the parse latency per sentence type and the
+ * display frames generated; the display calls are timed apart.
+ *
+ * Usage: program [--nmea <file>] [--out <file>] [--passes <n>]
+ *
+ * Each line of the log is injected at line rate on the virtual clock and
+ * followed by one recvNMEAData(), processNMEAData(), displayData() and
+ * nexPoll() call, so exactly one sentence is parsed per call and can be
+ * timed on its own. While a line comes in nexPoll() runs every ms, as in
+ * loop(), so the replies of the HMI are seen in time and the age of the
+ * data on screen, the latency histogram, is what the board would see;
+ * under bkcmd=2 only the frames followed by a sendme probe are in it.
+ * The wall clock times of those calls are what is measured; the virtual
+ * clock only drives the firmware's own timing (i.e. the 50 ms display
+ * gate). The results are written as JSON to compare runs.
+ *
+ * Next to the replay a few building blocks are timed in isolation: parsing
+ * a sentence and its fields against the String based code they replaced,
+ * building the commands for the Nextion components, and the
+ * fixed-point damping and true wind against a floating point reference.
+ *
+ * @author  Roy Wassili (waps61 @gmail.com)
+ * @date    2020/09/06
+ */
+#include <Arduino.h>
+#include <NexEmulator.h>
+#include <NexHardware.h>
+#include <NMEAParser.h>
+#include <NMEAQueue.h>
+#include <NMEASerial.h>
+#include <LatencyHistogram.h>
+#include <TrueWind.h>
+#include <WindFilter.h>
+#include <WindMath.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <string>
+#include <vector>
+
+/* the firmware under test, from main.cpp */
+void recvNMEAData();
+void processNMEAData();
+void displayData();
+extern NMEAQueue nmeaQueue;
+extern NMEASerial nmeaSerial;
+extern LatencyHistogram frameLatency;
+
+bool halReadFile(const char *path, std::vector<uint8_t> &data);
+
+typedef std::chrono::steady_clock Clock;
+
+static inline uint64_t elapsedNs(Clock::time_point t0, Clock::time_point t1)
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+}
+
+/*
+ * Nanosecond samples of one sentence type.
+ */
+struct Samples
+{
+  std::vector<uint32_t> ns;
+
+  uint32_t percentile(unsigned p)
+  {
+    if (ns.empty())
+      return 0;
+    return ns[(ns.size() - 1) * p / 100];
+  }
+};
+
+/*
+ * @return the sentence type of a log line, i.e. "VWR" or "!AIVDM".
+ */
+static std::string lineType(const std::string &line)
+{
+  size_t comma = line.find(',');
+  std::string tag = line.substr(0, comma == std::string::npos ? 0 : comma);
+
+  if (tag.size() == 6 && tag[0] == '$' && tag[1] != 'P')
+    return tag.substr(3);
+  return tag.empty() ? "(none)" : tag;
+}
+
+/*
+ * Times nmeaParseFixed() against copying the field and calling atoi(), over
+ * every field of the log that holds a number. Both give whole numbers, as
+ * atoi() knows no decimals.
+ */
+static void benchFieldParse(const std::vector<std::string> &lines, FILE *out)
+{
+  std::vector<std::string> fields;
+  NMEASentence s;
+  char buf[NMEA_BUFFER_SIZE];
+  volatile long sink = 0;
+  int32_t v;
+
+  for (size_t i = 0; i < lines.size(); i++)
+  {
+    nmeaTokenize(lines[i].c_str(), &s);
+    for (uint8_t f = 1; f < s.count; f++)
+    {
+      if (nmeaFieldFixed(&s, f, 0, &v))
+        fields.push_back(std::string(nmeaField(&s, f), nmeaFieldLen(&s, f)));
+    }
+  }
+
+  Clock::time_point t0 = Clock::now();
+  for (size_t i = 0; i < fields.size(); i++)
+  {
+    memcpy(buf, fields[i].c_str(), fields[i].size() + 1); // as the old code did
+    sink += atoi(buf);
+  }
+  Clock::time_point t1 = Clock::now();
+  for (size_t i = 0; i < fields.size(); i++)
+  {
+    nmeaParseFixed(fields[i].c_str(), fields[i].size(), 0, &v);
+    sink += v;
+  }
+  Clock::time_point t2 = Clock::now();
+  (void)sink;
+
+  double n = fields.empty() ? 1 : fields.size();
+  fprintf(out, "  \"field_parse\": {\"fields\": %u, \"decimals\": 0, \"atoi_ns\": %.1f, \"fixed_ns\": %.1f},\n",
+          (unsigned)fields.size(), elapsedNs(t0, t1) / n, elapsedNs(t1, t2) / n);
+}
+
+/*
+ * processNMEAData() as it was before the tokenizer, for reference: the
+ * sentence is copied into a String, cut up with indexOf() and the fields
+ * are copied out as text.
+ */
+#define LEGACY_FIELD 15
+static char legacyAWA[LEGACY_FIELD];
+static char legacyAWS[LEGACY_FIELD];
+static char legacyDIR[LEGACY_FIELD];
+static char legacySOG[LEGACY_FIELD];
+static char legacyCOG[LEGACY_FIELD];
+
+static void legacyProcess(const char *receivedChars)
+{
+  static String sentence;
+  char cvalue[LEGACY_FIELD] = {0};
+  unsigned int ci, li, cp;
+  int field;
+
+  sentence = String(receivedChars);
+  ci = sentence.indexOf(',', 0);
+  li = sentence.indexOf(',', ci + 1);
+  if (sentence.indexOf("MWV", 0) > 0 ||
+      sentence.indexOf("RMC") > 0 ||
+      sentence.indexOf("VWR") > 0)
+  {
+    field = 0;
+    while (li < sentence.length() && li < NMEA_BUFFER_SIZE)
+    {
+      cp = 0;
+      while (ci + 1 < li && cp < LEGACY_FIELD - 1) // the original had no bound
+      {
+        cvalue[cp++] = sentence[ci + 1];
+        ci++;
+      }
+      cvalue[cp] = '\0';
+      field++;
+      if ((sentence.indexOf("MWV") > 0 && sentence.indexOf(",R,") > 0) ||
+          sentence.indexOf("VWR") > 0)
+      {
+        if (field == 1)
+          memcpy(legacyAWA, cvalue, LEGACY_FIELD - 1);
+        if (field == 2)
+        {
+          memcpy(legacyDIR, cvalue, LEGACY_FIELD - 1);
+          if (legacyDIR[0] == 'L' || legacyDIR[0] == 'T')
+          {
+            memmove(legacyAWA + 1, legacyAWA, LEGACY_FIELD - 2);
+            legacyAWA[0] = '-';
+          }
+        }
+        if (field == 3)
+          memcpy(legacyAWS, cvalue, LEGACY_FIELD - 1);
+      }
+      if (sentence.indexOf("RMC") > 0)
+      {
+        if (field == 7)
+          memcpy(legacySOG, cvalue, LEGACY_FIELD - 1);
+        if (field == 8)
+          memcpy(legacyCOG, cvalue, LEGACY_FIELD - 1);
+      }
+      ci = li;
+      li = sentence.indexOf(',', ci + 1);
+      if (li > NMEA_BUFFER_SIZE)
+        li = sentence.length();
+    }
+  }
+}
+
+/* the same fields taken from the tokenized sentence */
+static bool tokenWind(const NMEASentence *s)
+{
+  nmeaCopyField(s, 1, legacyAWA, LEGACY_FIELD);
+  nmeaCopyField(s, 2, legacyDIR, LEGACY_FIELD);
+  nmeaCopyField(s, 3, legacyAWS, LEGACY_FIELD);
+  return true;
+}
+
+static bool tokenMWV(const NMEASentence *s)
+{
+  return nmeaFieldLen(s, 2) == 1 && nmeaField(s, 2)[0] == 'R' && tokenWind(s);
+}
+
+static bool tokenRMC(const NMEASentence *s)
+{
+  nmeaCopyField(s, 7, legacySOG, LEGACY_FIELD);
+  nmeaCopyField(s, 8, legacyCOG, LEGACY_FIELD);
+  return true;
+}
+
+static const NMEADispatch tokenDecoders[] = {
+    {NMEA_SENTENCE_ID('V', 'W', 'R'), tokenWind},
+    {NMEA_SENTENCE_ID('M', 'W', 'V'), tokenMWV},
+    {NMEA_SENTENCE_ID('R', 'M', 'C'), tokenRMC},
+};
+
+/*
+ * Times the String and indexOf() parser the firmware had against the
+ * tokenizer and the dispatch table over every sentence of the log, with
+ * the same fields copied out, and counts the heap allocations per
+ * sentence. Only the parsing is compared, the fixed-point decoding that
+ * replaced the text fields is left out.
+ */
+static void benchSentenceParse(const std::vector<std::string> &lines, FILE *out)
+{
+  std::vector<std::string> sentences;
+  NMEASentence s;
+  unsigned long a0, a1;
+
+  for (size_t i = 0; i < lines.size(); i++)
+  {
+    size_t len = lines[i].find_last_not_of("\r\n");
+    // as in the receive buffer, without the line end
+    if (len != std::string::npos && len + 1 < NMEA_BUFFER_SIZE)
+      sentences.push_back(lines[i].substr(0, len + 1));
+  }
+
+  a0 = String::allocations();
+  Clock::time_point t0 = Clock::now();
+  for (size_t i = 0; i < sentences.size(); i++)
+    legacyProcess(sentences[i].c_str());
+  Clock::time_point t1 = Clock::now();
+  a1 = String::allocations();
+  for (size_t i = 0; i < sentences.size(); i++)
+  {
+    nmeaTokenize(sentences[i].c_str(), &s);
+    nmeaDispatch(&s, tokenDecoders, sizeof(tokenDecoders) / sizeof(tokenDecoders[0]));
+  }
+  Clock::time_point t2 = Clock::now();
+
+  double n = sentences.empty() ? 1 : sentences.size();
+  fprintf(out, "  \"sentence_parse\": {\"sentences\": %u, \"string_ns\": %.1f, \"string_allocs\": %.2f, \"token_ns\": %.1f},\n",
+          (unsigned)sentences.size(), elapsedNs(t0, t1) / n, (a1 - a0) / n, elapsedNs(t1, t2) / n);
+}
+
+/*
+ * The command builders as the Nex* classes had them, for reference.
+ */
+static void legacySetValue(const char *name, uint32_t number)
+{
+  char buf[10] = {0};
+  String cmd;
+
+  utoa(number, buf, 10);
+  cmd += name;
+  cmd += ".val=";
+  cmd += buf;
+  sendCommand(cmd.c_str());
+}
+
+static void legacySetText(const char *name, const char *text)
+{
+  String cmd;
+  cmd += name;
+  cmd += ".txt=\"";
+  cmd += text;
+  cmd += "\"";
+  sendCommand(cmd.c_str());
+}
+
+static void streamSetValue(const char *name, uint32_t number)
+{
+  sendCommandBegin();
+  sendCommandAdd(name);
+  sendCommandAdd(".val=");
+  sendCommandAdd(number);
+  sendCommandEnd();
+}
+
+static void streamSetText(const char *name, const char *text)
+{
+  sendCommandBegin();
+  sendCommandAdd(name);
+  sendCommandAdd(".txt=\"");
+  sendCommandAdd(text);
+  sendCommandAdd("\"");
+  sendCommandEnd();
+}
+
+/*
+ * Times building and sending a setter command with a String, as the Nex*
+ * classes did, against streaming it with sendCommandAdd(), and counts the
+ * heap allocations per call. The panel is detached so only the firmware
+ * side is measured.
+ */
+static void benchCommandBuild(FILE *out)
+{
+  const unsigned calls = 100000;
+  volatile uint32_t number = 27315;
+  unsigned long a0, a1, a2, a3, a4;
+
+  Serial.onTransmit(NULL, NULL);
+  a0 = String::allocations();
+  Clock::time_point t0 = Clock::now();
+  for (unsigned i = 0; i < calls; i++)
+    legacySetValue("gauge", number);
+  Clock::time_point t1 = Clock::now();
+  a1 = String::allocations();
+  for (unsigned i = 0; i < calls; i++)
+    streamSetValue("gauge", number);
+  Clock::time_point t2 = Clock::now();
+  a2 = String::allocations();
+  for (unsigned i = 0; i < calls; i++)
+    legacySetText("t0", "12.3 kn");
+  Clock::time_point t3 = Clock::now();
+  a3 = String::allocations();
+  for (unsigned i = 0; i < calls; i++)
+    streamSetText("t0", "12.3 kn");
+  Clock::time_point t4 = Clock::now();
+  a4 = String::allocations();
+
+  fprintf(out, "  \"command_build\": {\"calls\": %u,\n", calls);
+  fprintf(out, "    \"set_value\": {\"string_ns\": %.1f, \"string_allocs\": %.1f, \"stream_ns\": %.1f, \"stream_allocs\": %.1f},\n",
+          elapsedNs(t0, t1) / (double)calls, (a1 - a0) / (double)calls,
+          elapsedNs(t1, t2) / (double)calls, (a2 - a1) / (double)calls);
+  fprintf(out, "    \"set_text\": {\"string_ns\": %.1f, \"string_allocs\": %.1f, \"stream_ns\": %.1f, \"stream_allocs\": %.1f}\n  },\n",
+          elapsedNs(t2, t3) / (double)calls, (a3 - a2) / (double)calls,
+          elapsedNs(t3, t4) / (double)calls, (a4 - a3) / (double)calls);
+}
+
+#define DAMPING_TAU 1000 // ms, as DAMPING_AWA in main.cpp
+
+/*
+ * @return the smallest difference of two angles in tenths, 0..1800.
+ */
+static double angleError(double a, double b)
+{
+  double d = fmod(fabs(a - b), 3600.0);
+  return d > 1800.0 ? 3600.0 - d : d;
+}
+
+/*
+ * The filters of WindFilter.h in doubles, as a reference.
+ */
+struct RefFilter
+{
+  double tau;
+  bool primed;
+  uint32_t updated;
+  double value, x, y;
+
+  explicit RefFilter(double tau)
+      : tau(tau), primed(false), updated(0), value(0), x(0), y(0) {}
+
+  double weight(uint32_t now)
+  {
+    double dt = now - updated;
+    bool reset = !primed || tau == 0 || dt >= 4 * tau;
+
+    updated = now;
+    primed = true;
+    return reset ? 1.0 : dt / (tau + dt);
+  }
+
+  double scalar(double v, uint32_t now)
+  {
+    double w = weight(now);
+    value += (v - value) * w;
+    return value;
+  }
+
+  double angle(double tenths, uint32_t now)
+  {
+    double w = weight(now);
+    double r = tenths * M_PI / 1800.0;
+    x += (cos(r) - x) * w;
+    y += (sin(r) - y) * w;
+    r = atan2(y, x) * 1800.0 / M_PI;
+    return r < 0 ? r + 3600.0 : r;
+  }
+};
+
+/*
+ * Checks the trigonometry over every angle and the damping filters against
+ * RefFilter on a synthetic wind that swings across the stern (+180/-180)
+ * and the bow, sampled at 1..10 Hz with jitter. The largest angle errors
+ * are where the average vector nearly vanishes, i.e. halfway a swing from
+ * bow to stern, and the angle means little anyway. Also times one update of
+ * both filters; these are host timings, on the Nano every update costs
+ * more but the ratio is what matters.
+ */
+static void benchDamping(FILE *out)
+{
+  const unsigned samples = 200000;
+  double sinErr = 0, atanErr = 0;
+  double angleMax = 0, angleSum = 0, scalarMax = 0, scalarSum = 0;
+  std::vector<int16_t> awa(samples), aws(samples);
+  std::vector<uint32_t> at(samples);
+  volatile int32_t sink = 0;
+  uint32_t now = 0;
+
+  for (int a = -3600; a < 3600; a++)
+  {
+    double r = a * M_PI / 1800.0;
+    sinErr = std::max(sinErr, fabs(windSin(a) / (double)WIND_Q15 - sin(r)));
+    sinErr = std::max(sinErr, fabs(windCos(a) / (double)WIND_Q15 - cos(r)));
+    atanErr = std::max(atanErr, angleError(windAtan2(windSin(a), windCos(a)), a));
+    atanErr = std::max(atanErr, angleError(windAtan2(100000L * sin(r), 100000L * cos(r)), a));
+  }
+
+  srand(1);
+  for (unsigned i = 0; i < samples; i++)
+  {
+    double swing = (i / 600) % 2 ? 1800.0 : 0.0; // stern, then bow
+    double a = swing + 400.0 * sin(i / 97.0) + (rand() % 201 - 100);
+    a = fmod(a + 5400.0, 3600.0) - 1800.0;
+    awa[i] = (int16_t)lround(a);
+    aws[i] = (int16_t)(150 + 100 * sin(i / 53.0) + rand() % 41 - 20);
+    now += 100 + rand() % 900;
+    at[i] = now;
+  }
+
+  WindAngleFilter angle(DAMPING_TAU);
+  WindScalarFilter scalar(DAMPING_TAU);
+  RefFilter refAngle(DAMPING_TAU), refScalar(DAMPING_TAU);
+  for (unsigned i = 0; i < samples; i++)
+  {
+    double e = angleError(windFilter(&angle, awa[i], at[i]), refAngle.angle(awa[i], at[i]));
+    angleMax = std::max(angleMax, e);
+    angleSum += e;
+    e = fabs(windFilter(&scalar, aws[i], at[i]) - refScalar.scalar(aws[i], at[i]));
+    scalarMax = std::max(scalarMax, e);
+    scalarSum += e;
+  }
+
+  Clock::time_point t0 = Clock::now();
+  for (unsigned i = 0; i < samples; i++)
+    sink += windFilter(&angle, awa[i], at[i]);
+  Clock::time_point t1 = Clock::now();
+  for (unsigned i = 0; i < samples; i++)
+    sink += (int32_t)refAngle.angle(awa[i], at[i]);
+  Clock::time_point t2 = Clock::now();
+  for (unsigned i = 0; i < samples; i++)
+    sink += windFilter(&scalar, aws[i], at[i]);
+  Clock::time_point t3 = Clock::now();
+  for (unsigned i = 0; i < samples; i++)
+    sink += (int32_t)refScalar.scalar(aws[i], at[i]);
+  Clock::time_point t4 = Clock::now();
+  (void)sink;
+
+  fprintf(out, "  \"damping\": {\"samples\": %u, \"tau_ms\": %u,\n", samples, DAMPING_TAU);
+  fprintf(out, "    \"trig\": {\"sin_cos_max_error\": %.6f, \"atan2_max_error_tenths\": %.2f},\n",
+          sinErr, atanErr);
+  fprintf(out, "    \"angle\": {\"max_error_tenths\": %.2f, \"mean_error_tenths\": %.3f, \"fixed_ns\": %.1f, \"double_ns\": %.1f},\n",
+          angleMax, angleSum / samples, elapsedNs(t0, t1) / (double)samples, elapsedNs(t1, t2) / (double)samples);
+  fprintf(out, "    \"scalar\": {\"max_error_tenths\": %.2f, \"mean_error_tenths\": %.3f, \"fixed_ns\": %.1f, \"double_ns\": %.1f}\n  },\n",
+          scalarMax, scalarSum / samples, elapsedNs(t2, t3) / (double)samples, elapsedNs(t3, t4) / (double)samples);
+}
+
+/*
+ * Compares trueWindSolve() with the same vector maths in doubles over the
+ * full circle of AWA, AWS and SOG up to 60 kts, and times both. Speeds up
+ * to WIND_VALUE_MAX are checked apart. The error grows with the speed.
+ * TWA is not compared where the true wind is below 0.5 kts. Its direction
+ * is noise there.
+ */
+static void benchTrueWind(FILE *out)
+{
+  std::vector<int16_t> in, extreme;
+  double extremeMax = 0, speedMax = 0, speedSum = 0, angleMax = 0, angleSum = 0;
+  unsigned angles = 0;
+  volatile int32_t sink = 0;
+  int16_t tws, twa, twd;
+
+  for (int awa = -1800; awa <= 1800; awa += 7)
+  {
+    for (int aws = 0; aws <= 600; aws += 13)
+    {
+      for (int sog = 0; sog <= 600; sog += 17)
+      {
+        in.push_back(awa);
+        in.push_back(aws);
+        in.push_back(sog);
+      }
+    }
+    for (int aws = 0; aws <= WIND_VALUE_MAX; aws += WIND_VALUE_MAX / 4)
+    {
+      extreme.push_back(awa);
+      extreme.push_back(aws);
+      extreme.push_back(WIND_VALUE_MAX - aws);
+    }
+  }
+
+  const unsigned solves = in.size() / 3;
+  for (unsigned i = 0; i < extreme.size(); i += 3)
+  {
+    double r = extreme[i] * M_PI / 1800.0;
+    double speed = hypot(extreme[i + 1] * cos(r) - extreme[i + 2], extreme[i + 1] * sin(r));
+
+    trueWindSolve(extreme[i], extreme[i + 1], extreme[i + 2], 0, &tws, &twa, &twd);
+    extremeMax = std::max(extremeMax, fabs(tws - std::min(speed, (double)WIND_VALUE_MAX)));
+  }
+  for (unsigned i = 0; i < in.size(); i += 3)
+  {
+    double r = in[i] * M_PI / 1800.0;
+    double x = in[i + 1] * cos(r) - in[i + 2];
+    double y = in[i + 1] * sin(r);
+    double speed = hypot(x, y);
+
+    trueWindSolve(in[i], in[i + 1], in[i + 2], 0, &tws, &twa, &twd);
+    speedMax = std::max(speedMax, fabs(tws - speed));
+    speedSum += fabs(tws - speed);
+    if (speed >= 5)
+    {
+      double e = angleError(twa, atan2(y, x) * 1800.0 / M_PI);
+      angleMax = std::max(angleMax, e);
+      angleSum += e;
+      angles++;
+    }
+  }
+
+  Clock::time_point t0 = Clock::now();
+  for (unsigned i = 0; i < in.size(); i += 3)
+  {
+    trueWindSolve(in[i], in[i + 1], in[i + 2], 900, &tws, &twa, &twd);
+    sink += tws + twa + twd;
+  }
+  Clock::time_point t1 = Clock::now();
+  for (unsigned i = 0; i < in.size(); i += 3)
+  {
+    double r = in[i] * M_PI / 1800.0;
+    double x = in[i + 1] * cos(r) - in[i + 2];
+    double y = in[i + 1] * sin(r);
+    double a = atan2(y, x) * 1800.0 / M_PI;
+    sink += (int32_t)hypot(x, y) + (int32_t)a + (int32_t)fmod(a + 4500.0, 3600.0);
+  }
+  Clock::time_point t2 = Clock::now();
+  (void)sink;
+
+  fprintf(out, "  \"true_wind\": {\"solves\": %u,\n", solves);
+  fprintf(out, "    \"tws\": {\"max_error_tenths\": %.2f, \"mean_error_tenths\": %.3f, \"extreme_max_error_tenths\": %.2f},\n",
+          speedMax, speedSum / solves, extremeMax);
+  fprintf(out, "    \"twa\": {\"max_error_tenths\": %.2f, \"mean_error_tenths\": %.3f},\n",
+          angleMax, angles ? angleSum / angles : 0.0);
+  fprintf(out, "    \"fixed_ns\": %.1f, \"double_ns\": %.1f\n  },\n",
+          elapsedNs(t0, t1) / (double)solves, elapsedNs(t1, t2) / (double)solves);
+}
+
+int main(int argc, char **argv)
+{
+  const char *input = "test/Yazz_test_zeilend.txt";
+  const char *output = "bench_replay.json";
+  unsigned passes = 1;
+  std::vector<uint8_t> data;
+  std::vector<std::string> lines;
+  std::map<std::string, Samples> types;
+  uint64_t totalNs = 0;
+  uint64_t displayNs = 0;
+  uint64_t bytes = 0;
+  uint64_t sentences = 0;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--nmea") == 0 && i + 1 < argc)
+      input = argv[++i];
+    else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+      output = argv[++i];
+    else if (strcmp(argv[i], "--passes") == 0 && i + 1 < argc)
+      passes = strtoul(argv[++i], NULL, 10);
+    else
+    {
+      fprintf(stderr, "usage: %s [--nmea <file>] [--out <file>] [--passes <n>]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (!halReadFile(input, data))
+  {
+    fprintf(stderr, "cannot read %s\n", input);
+    return 1;
+  }
+  for (size_t start = 0; start < data.size();)
+  {
+    size_t end = start;
+    while (end < data.size() && data[end] != '\n')
+      end++;
+    lines.push_back(std::string(data.begin() + start, data.begin() + std::min(end + 1, data.size())));
+    start = end + 1;
+  }
+
+  NexEmulator hmi(Serial);
+  hmi.set("status.pic", 4);
+  setup();
+
+  for (unsigned pass = 0; pass < passes; pass++)
+  {
+    for (size_t i = 0; i < lines.size(); i++)
+    {
+      const std::string &line = lines[i];
+
+      Serial1.inject((const uint8_t *)line.data(), line.size());
+      uint64_t due = Serial1.nextArrival() + Serial1.byteTime() * (line.size() - 1);
+      while (halNow() + 1000 < due)
+      {
+        halAdvance(1000);
+        nexPoll();
+      }
+      halAdvanceTo(due);
+
+      Clock::time_point t0 = Clock::now();
+      recvNMEAData();
+      processNMEAData();
+      Clock::time_point t1 = Clock::now();
+      displayData();
+      nexPoll();
+      Clock::time_point t2 = Clock::now();
+
+      uint64_t ns = elapsedNs(t0, t1);
+      types[lineType(line)].ns.push_back((uint32_t)ns);
+      totalNs += ns;
+      displayNs += elapsedNs(t1, t2);
+      bytes += line.size();
+      sentences++;
+    }
+  }
+
+  FILE *out = fopen(output, "w");
+  if (!out)
+  {
+    fprintf(stderr, "cannot write %s\n", output);
+    return 1;
+  }
+  double seconds = totalNs / 1e9;
+  fprintf(out, "{\n");
+  fprintf(out, "  \"input\": \"%s\",\n  \"passes\": %u,\n", input, passes);
+  fprintf(out, "  \"sentences\": %llu,\n  \"bytes\": %llu,\n",
+          (unsigned long long)sentences, (unsigned long long)bytes);
+  fprintf(out, "  \"parse_seconds\": %.6f,\n  \"display_seconds\": %.6f,\n",
+          seconds, displayNs / 1e9);
+  fprintf(out, "  \"parse_sentences_per_second\": %.0f,\n  \"parse_bytes_per_second\": %.0f,\n",
+          sentences / seconds, bytes / seconds);
+  fprintf(out, "  \"virtual_seconds\": %.3f,\n", halNow() / 1e6);
+  fprintf(out, "  \"display_frames\": %u,\n  \"nextion_commands\": %u,\n",
+          hmi.verbs().count("sys2") ? hmi.verbs().at("sys2") : 0, hmi.commands());
+  fprintf(out, "  \"queue_high_water\": %u,\n  \"queue_dropped\": %u,\n  \"rx_overflows\": %u,\n",
+          nmeaQueue.highWater(), nmeaQueue.dropped(), nmeaSerial.overflows());
+  fprintf(out, "  \"latency\": {\"max_us\": %u, \"buckets\": [", frameLatency.max);
+  for (uint8_t b = 0; b < LATENCY_BUCKETS; b++)
+    fprintf(out, "%s\n    {\"from_us\": %u, \"count\": %u}", b ? "," : "",
+            latencyBucketStart(b), frameLatency.count[b]);
+  fprintf(out, "\n  ]},\n");
+  benchSentenceParse(lines, out);
+  benchFieldParse(lines, out);
+  benchCommandBuild(out);
+  benchDamping(out);
+  benchTrueWind(out);
+  fprintf(out, "  \"types\": {");
+  for (std::map<std::string, Samples>::iterator it = types.begin(); it != types.end(); ++it)
+  {
+    Samples &s = it->second;
+    std::sort(s.ns.begin(), s.ns.end());
+    fprintf(out, "%s\n    \"%s\": {\"count\": %u, \"p50_ns\": %u, \"p90_ns\": %u, \"p99_ns\": %u, \"max_ns\": %u}",
+            it == types.begin() ? "" : ",", it->first.c_str(), (unsigned)s.ns.size(),
+            s.percentile(50), s.percentile(90), s.percentile(99), s.ns.back());
+  }
+  fprintf(out, "\n  }\n}\n");
+  fclose(out);
+
+  fprintf(stderr, "%llu sentences, parsed at %.0f sentences/s, %.0f bytes/s, %u display frames -> %s\n",
+          (unsigned long long)sentences, sentences / seconds, bytes / seconds,
+          hmi.verbs().count("sys2") ? hmi.verbs().at("sys2") : 0, output);
+  return 0;
+}
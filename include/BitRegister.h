@@ -0,0 +1,122 @@
+/**
+ * @file BitRegister.h
+ *
+ * Compile-time layout of a 32-bit register made of bit-fields, i.e. the sys2
+ * variable through which the whole wind display is updated at once.
+ *
+ * The offset and width of each field are declared once; packing and
+ * unpacking compile to plain shifts and masks without branches, and a
+ * layout with overlapping or overflowing fields does not compile.
+ *
+ * Example:
+ *   typedef BitField<0, 6> Speed;
+ *   typedef BitField<6, 9> Angle;
+ *   typedef BitRegister<Speed, Angle> Reg;
+ *   uint32_t r = Reg::pack(speed, angle);
+ *   uint32_t a = Angle::unpack(r);
+ *
+ * @author  Roy Wassili (waps61 @gmail.com)
+ * @date    2020/09/06
+ */
+#ifndef __BITREGISTER_H__
+#define __BITREGISTER_H__
+
+#include <Arduino.h>
+
+/**
+ * A field of Width bits starting at bit Offset of a 32-bit register.
+ */
+template <uint8_t Offset, uint8_t Width>
+struct BitField
+{
+  static_assert(Width > 0, "a field needs at least 1 bit");
+  static_assert(Offset + Width <= 32, "field does not fit in 32 bits");
+
+  static constexpr uint8_t offset = Offset;
+  static constexpr uint8_t width = Width;
+  /** largest value the field can hold */
+  static constexpr uint32_t max = Width == 32 ? 0xFFFFFFFFUL : (1UL << Width) - 1;
+  /** the bits of the field within the register */
+  static constexpr uint32_t mask = max << Offset;
+
+  /**
+   * @return value shifted into place; bits above the width are dropped.
+   */
+  static constexpr uint32_t pack(uint32_t value)
+  {
+    return (value & max) << Offset;
+  }
+
+  /**
+   * @return the value of the field in reg.
+   */
+  static constexpr uint32_t unpack(uint32_t reg)
+  {
+    return (reg >> Offset) & max;
+  }
+
+  /**
+   * @return reg with the field replaced by value.
+   */
+  static constexpr uint32_t insert(uint32_t reg, uint32_t value)
+  {
+    return (reg & ~mask) | pack(value);
+  }
+};
+
+/**
+ * A register made of the given fields, which may not overlap. Unused bits
+ * are allowed.
+ */
+template <typename... Fields>
+struct BitRegister;
+
+template <>
+struct BitRegister<>
+{
+  static constexpr uint32_t mask = 0;
+
+  static constexpr uint32_t pack(void)
+  {
+    return 0;
+  }
+};
+
+template <typename Field, typename... Rest>
+struct BitRegister<Field, Rest...>
+{
+  static_assert((Field::mask & BitRegister<Rest...>::mask) == 0, "fields overlap");
+
+  /** the bits used by all fields */
+  static constexpr uint32_t mask = Field::mask | BitRegister<Rest...>::mask;
+
+  /**
+   * @return the register holding one value per field, in the order the
+   * fields are declared.
+   */
+  template <typename... Values>
+  static constexpr uint32_t pack(uint32_t value, Values... rest)
+  {
+    return Field::pack(value) | BitRegister<Rest...>::pack(rest...);
+  }
+};
+
+/**
+ * Checks at compile time that every value lo..hi of a field survives a pack
+ * and unpack, also when all other bits of the register are set. The range
+ * is split in halves, so the recursion depth stays at log2 of its size.
+ *
+ * Use as: static_assert(bitFieldRoundTrips<F>(0, F::max), "...");
+ */
+template <typename Field>
+constexpr bool bitFieldRoundTrips(uint32_t lo, uint32_t hi)
+{
+  return lo == hi
+             ? Field::unpack(Field::pack(lo)) == lo &&
+                   Field::unpack(Field::pack(lo) | ~Field::mask) == lo &&
+                   (Field::pack(lo) & ~Field::mask) == 0
+             : bitFieldRoundTrips<Field>(lo, lo + (hi - lo) / 2) &&
+                   bitFieldRoundTrips<Field>(lo + (hi - lo) / 2 + 1, hi);
+}
+
+#endif /* #ifndef __BITREGISTER_H__ */
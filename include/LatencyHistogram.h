@@ -0,0 +1,49 @@
+/**
+ * @file LatencyHistogram.h
+ *
+ * Histogram of the age of the data on the display: the time from the
+ * arrival of the '$' of a sentence until the HMI acknowledged the sys2
+ * frame showing it.
+ *
+ * The buckets are powers of 2, so 16 counters span 1 ms to over 16 s and
+ * recording an age is a few shifts.
+ *
+ * @author  Roy Wassili (waps61 @gmail.com)
+ * @date    2020/09/15
+ */
+#ifndef __LATENCYHISTOGRAM_H__
+#define __LATENCYHISTOGRAM_H__
+
+#include <Arduino.h>
+
+/**
+ * Nr of buckets; bucket 0 counts the ages below 2^LATENCY_SHIFT us, bucket
+ * i > 0 the ages of 2^(LATENCY_SHIFT + i - 1) up to 2^(LATENCY_SHIFT + i) us
+ * and the last one everything above.
+ */
+#define LATENCY_BUCKETS 16
+#define LATENCY_SHIFT 10
+
+struct LatencyHistogram
+{
+  uint16_t count[LATENCY_BUCKETS]; /* saturate at 65535 */
+  uint32_t max;                    /* oldest age seen in us */
+};
+
+/**
+ * Counts an age in us.
+ */
+void latencyRecord(LatencyHistogram *h, uint32_t us);
+
+/**
+ * @return the lower bound in us of bucket i.
+ */
+uint32_t latencyBucketStart(uint8_t i);
+
+/**
+ * Writes the histogram over the debug serial, one line per bucket that
+ * is not empty: the lower bound in us and the count.
+ */
+void latencyDump(const LatencyHistogram *h);
+
+#endif /* #ifndef __LATENCYHISTOGRAM_H__ */
@@ -0,0 +1,102 @@
+/**
+ * @file LoopStats.h
+ *
+ * Timing of the stages of loop(): min, average and max in us per stage,
+ * the worst loop period and how full the receive buffer got.
+ *
+ * loop() marks its stages with the macros below. Without
+ * LOOP_STATS_ENABLED they compile to nothing, so the instrumentation costs
+ * neither flash, RAM nor time when it is not needed.
+ *
+ * @author  Roy Wassili (waps61 @gmail.com)
+ * @date    2020/09/14
+ */
+#ifndef __LOOPSTATS_H__
+#define __LOOPSTATS_H__
+
+#include <Arduino.h>
+
+/**
+ * Define LOOP_STATS_ENABLED to measure loop().
+ */
+//#define LOOP_STATS_ENABLED 1
+
+/**
+ * The stages of loop(); STAGE_LOOP is the period of loop() itself.
+ */
+enum LoopStage
+{
+  STAGE_RECEIVE,
+  STAGE_PARSE,
+  STAGE_DISPLAY,
+  STAGE_POLL,
+  STAGE_LOOP,
+  LOOP_STAGES
+};
+
+/**
+ * Timing of one stage since it was last reset, in us; times beyond
+ * 65535 us are counted as 65535.
+ */
+struct LoopStageStats
+{
+  uint16_t min;
+  uint16_t max;
+  uint32_t sum;
+  uint32_t count;
+};
+
+#ifdef LOOP_STATS_ENABLED
+/**
+ * Starts a loop; rxFill is the nr of bytes waiting in the receive buffer,
+ * which is at its fullest right before it is read.
+ */
+#define LOOP_STATS_BEGIN(rxFill) \
+  uint32_t __stageStart = loopStatsBegin(rxFill)
+
+/**
+ * Ends a stage, which started where the previous one ended.
+ */
+#define LOOP_STATS_STAGE(stage) \
+  __stageStart = loopStatsStage(stage, __stageStart)
+#else
+#define LOOP_STATS_BEGIN(rxFill)
+#define LOOP_STATS_STAGE(stage)
+#endif
+
+/**
+ * @return micros() at the start of the loop.
+ */
+uint32_t loopStatsBegin(uint8_t rxFill);
+
+/**
+ * @return micros() at the end of the stage.
+ */
+uint32_t loopStatsStage(uint8_t stage, uint32_t start);
+
+/**
+ * @return the timing of a stage.
+ */
+const LoopStageStats *loopStats(uint8_t stage);
+
+/**
+ * Starts over the timing of a stage, i.e. after it was reported.
+ */
+void loopStatsReset(uint8_t stage);
+
+/**
+ * @return the highest nr of bytes seen waiting in the receive buffer.
+ */
+uint8_t loopStatsRxHighWater(void);
+
+/**
+ * Builds the next stage report, without the checksum, for the relay:
+ * $PYAZT,<stage>,<min>,<avg>,<max> with stage R(eceive), P(arse),
+ * D(isplay), N(extion poll) or L(oop period). Every call reports the next
+ * stage and starts over its timing.
+ *
+ * @return the nr of characters written, 0 when size is too small.
+ */
+uint8_t loopStatsSentence(char *buf, uint8_t size);
+
+#endif /* #ifndef __LOOPSTATS_H__ */
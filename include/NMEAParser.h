@@ -0,0 +1,185 @@
+/**
+ * @file NMEAParser.h
+ *
+ * Zero-allocation helpers to split an NMEA0183 sentence into its fields.
+ *
+ * The tokenizer walks the receive buffer exactly once and records for every
+ * field its offset and length inside that buffer. No characters are copied
+ * and nothing is allocated on the heap, so the sentence can be parsed right
+ * where it was received.
+ *
+ * @author  Roy Wassili (waps61 @gmail.com)
+ * @date    2020/08/31
+ */
+#ifndef __NMEAPARSER_H__
+#define __NMEAPARSER_H__
+
+#include <Arduino.h>
+
+/**
+ * Maximum number of fields recorded per sentence, including the tag in
+ * field 0. Fields beyond this limit are ignored.
+ */
+#define NMEA_MAX_FIELDS 20
+
+/**
+ * Location of a single field inside the sentence buffer.
+ */
+struct NMEAField
+{
+  uint8_t start; /* offset of the 1st character of the field */
+  uint8_t len;   /* number of characters, 0 for an empty field */
+};
+
+/**
+ * A tokenized sentence; the fields refer to the buffer passed to
+ * nmeaTokenize() which must stay untouched while the fields are used.
+ */
+struct NMEASentence
+{
+  const char *buf;
+  uint8_t count; /* number of valid entries in field[] */
+  NMEAField field[NMEA_MAX_FIELDS];
+};
+
+/**
+ * Splits a received sentence into its comma separated fields.
+ *
+ * The start delimiter ('$' or '!') is skipped, so field 0 holds the tag
+ * (i.e. "IIVWR"). Tokenizing stops at the checksum delimiter '*', at <CR>,
+ * <LF> or at the terminating '\0'.
+ *
+ * @param buf - '\0' terminated sentence as received.
+ * @param s - the sentence to fill.
+ *
+ * @return the number of fields found.
+ */
+uint8_t nmeaTokenize(const char *buf, NMEASentence *s);
+
+/**
+ * Copies field i as a '\0' terminated string into dst, truncated to size-1
+ * characters. An empty or missing field results in an empty string.
+ *
+ * @return the number of characters copied.
+ */
+uint8_t nmeaCopyField(const NMEASentence *s, uint8_t i, char *dst, uint8_t size);
+
+/**
+ * @return a pointer to the 1st character of field i or NULL if the sentence
+ * has less than i+1 fields.
+ */
+inline const char *nmeaField(const NMEASentence *s, uint8_t i)
+{
+  return i < s->count ? s->buf + s->field[i].start : NULL;
+}
+
+/**
+ * @return the length of field i, 0 if it is empty or missing.
+ */
+inline uint8_t nmeaFieldLen(const NMEASentence *s, uint8_t i)
+{
+  return i < s->count ? s->field[i].len : 0;
+}
+
+/**
+ * Parses a decimal number like "-24.3" or "104.73" into a fixed-point integer
+ * with the given number of decimals, i.e. "104.73" with 1 decimal gives 1047.
+ * Surplus decimals are rounded half away from zero, missing ones are padded.
+ * Only an optional sign, digits and a single '.' are accepted and at most 9
+ * digits are used, padding included, so the result always fits in 32 bits;
+ * a longer number fails.
+ *
+ * @param p - 1st character of the number, does not need to be terminated.
+ * @param len - number of characters.
+ * @param decimals - number of decimals in the result.
+ * @param value - receives the result, untouched when parsing fails.
+ *
+ * @retval true - the field holds a valid number.
+ * @retval false - the field is empty or malformed.
+ */
+bool nmeaParseFixed(const char *p, uint8_t len, uint8_t decimals, int32_t *value);
+
+/**
+ * Parses field i of a tokenized sentence with nmeaParseFixed().
+ */
+inline bool nmeaFieldFixed(const NMEASentence *s, uint8_t i, uint8_t decimals, int32_t *value)
+{
+  return i < s->count && nmeaParseFixed(s->buf + s->field[i].start, s->field[i].len, decimals, value);
+}
+
+/**
+ * Packs the 3 character sentence formatter (i.e. 'V','W','R') into a single
+ * integer key so sentence types can be compared and switched on at once.
+ */
+#define NMEA_SENTENCE_ID(a, b, c) \
+  (((uint32_t)(uint8_t)(a) << 16) | ((uint16_t)(uint8_t)(b) << 8) | (uint8_t)(c))
+
+/**
+ * Type of the function decoding one sentence type into the application data.
+ *
+ * @param s - the tokenized sentence.
+ *
+ * @return true when the sentence updated a value, false when it was ignored
+ *  or only invalidated values.
+ */
+typedef bool (*NMEADecoder)(const NMEASentence *s);
+
+/**
+ * Entry of a dispatch table, mapping a sentence id to its decoder.
+ */
+struct NMEADispatch
+{
+  uint32_t id;        /* key made with NMEA_SENTENCE_ID() */
+  NMEADecoder decode; /* called for every sentence with this id */
+};
+
+/**
+ * Derives the sentence id from the tag in field 0; the 2 character talker
+ * id is ignored so $IIVWR and $WIVWR map onto the same id.
+ *
+ * @return the sentence id or 0 for proprietary ($P...) and malformed tags.
+ */
+uint32_t nmeaSentenceId(const NMEASentence *s);
+
+/**
+ * Derives the sentence id straight from a raw sentence buffer, i.e. before
+ * it is tokenized. Needs the start delimiter and the complete tag, so at
+ * least the first 7 characters ("$IIVWR,").
+ *
+ * @return the sentence id or 0 for proprietary ($P...) and malformed tags.
+ */
+uint32_t nmeaTagId(const char *sentence);
+
+/**
+ * @return the value 0-15 of hexadecimal digit c or -1 if c is no such digit.
+ */
+int8_t nmeaHexValue(char c);
+
+/**
+ * Completes a sentence of our own: appends the checksum of the characters
+ * after the start delimiter, <CR><LF> and a '\0'.
+ *
+ * @param buf - the sentence up to the checksum, i.e. "$PYAZR,12,3".
+ * @param len - nr of characters in buf.
+ * @param size - size of buf.
+ *
+ * @return the length of the complete sentence, 0 if it does not fit.
+ */
+uint8_t nmeaAppendChecksum(char *buf, uint8_t len, uint8_t size);
+
+/**
+ * Looks up a sentence id in a dispatch table.
+ *
+ * @return the index of the matching entry or -1 if there is none.
+ */
+int8_t nmeaLookup(uint32_t id, const NMEADispatch *table, uint8_t count);
+
+/**
+ * Calls the decoder registered for the type of sentence s, if any.
+ *
+ * @retval true - the decoder updated a value.
+ * @retval false - it did not, or the sentence type is not in the table.
+ */
+bool nmeaDispatch(const NMEASentence *s, const NMEADispatch *table, uint8_t count);
+
+#endif /* #ifndef __NMEAPARSER_H__ */
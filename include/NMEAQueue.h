@@ -0,0 +1,139 @@
+/**
+ * @file NMEAQueue.h
+ *
+ * The definition of class NMEAQueue, a queue of fixed-size sentence slots.
+ *
+ * The receiver fills one slot while the sentences received before it wait
+ * in the other slots to be parsed, so reception never has to stop while a
+ * sentence is pending. A parsed sentence can be held in its slot, so it
+ * can be relayed from there without a copy.
+ *
+ * Slots are not used in ring order: the next receive slot is any slot that
+ * is neither pending nor held, so a sentence still going out downstream
+ * never blocks the slot after it. The price of relaying without a copy is
+ * that held slots are not available to the receiver: only when pending and
+ * held sentences take all other slots is a new one dropped. The relay
+ * therefore holds at most NMEA_QUEUE_HOLD_MAX slots and sheds the rest,
+ * so the decoder always has a slot, and relaying never costs the display
+ * its own input.
+ *
+ * @author  Roy Wassili (waps61 @gmail.com)
+ * @date    2020/08/31
+ */
+#ifndef __NMEAQUEUE_H__
+#define __NMEAQUEUE_H__
+
+#include <Arduino.h>
+
+/**
+ * Size of a sentence slot. According NMEA0183 specs the max nr of characters
+ * is 82, so 82 + '\0'.
+ */
+#define NMEA_BUFFER_SIZE 83
+
+/**
+ * Nr of slots in the queue, at most 8; one of them is always the receive
+ * slot, the others hold complete sentences waiting to be parsed or relayed.
+ */
+#define NMEA_QUEUE_SLOTS 4
+
+/**
+ * Nr of slots that may be held at the same time; this leaves the receive
+ * slot and at least one slot for a sentence waiting to be parsed.
+ */
+#define NMEA_QUEUE_HOLD_MAX (NMEA_QUEUE_SLOTS - 2)
+
+/**
+ * Queue of sentence slots between the receiver and the parser.
+ */
+class NMEAQueue
+{
+public: /* methods */
+  NMEAQueue(void);
+
+  /**
+   * Slot to receive the next sentence into. It stays the same slot until
+   * commit() is called, so an abandoned sentence is simply overwritten.
+   *
+   * @return a buffer of NMEA_BUFFER_SIZE characters.
+   */
+  char *receiveSlot(void);
+
+  /**
+   * Appends the sentence in the receive slot to the queue.
+   *
+   * @param len - nr of characters in the sentence, excluding the '\0'.
+   * @param stamp - micros() the sentence began to arrive.
+   *
+   * @retval true - the sentence is queued.
+   * @retval false - all other slots are pending or held; the sentence is
+   * dropped and counted.
+   */
+  bool commit(uint8_t len, uint32_t stamp = 0);
+
+  /**
+   * @return the oldest pending sentence or NULL when the queue is empty.
+   */
+  const char *front(void);
+
+  /**
+   * @return the length of the oldest pending sentence.
+   */
+  uint8_t frontLength(void);
+
+  /**
+   * @return the stamp the oldest pending sentence was committed with.
+   */
+  uint32_t frontStamp(void);
+
+  /**
+   * Releases the oldest pending sentence so its slot can be reused.
+   */
+  void pop(void);
+
+  /**
+   * Takes the oldest pending sentence off the queue like pop(), but keeps
+   * its slot in use until release() is called, i.e. while it is relayed.
+   */
+  void hold(void);
+
+  /**
+   * Frees the slot of the oldest held sentence; slots are held and freed
+   * in the same order.
+   */
+  void release(void);
+
+  /**
+   * @return the nr of held sentences.
+   */
+  uint8_t held(void);
+
+  /**
+   * @return the nr of pending sentences.
+   */
+  uint8_t pending(void);
+
+  /**
+   * @return the highest nr of sentences that were pending at the same time.
+   */
+  uint8_t highWater(void);
+
+  /**
+   * @return the nr of complete sentences dropped because all other slots
+   * were pending or held.
+   */
+  uint16_t dropped(void);
+
+private: /* data */
+  char __data[NMEA_QUEUE_SLOTS][NMEA_BUFFER_SIZE];
+  uint8_t __len[NMEA_QUEUE_SLOTS];
+  uint32_t __stamp[NMEA_QUEUE_SLOTS];
+  uint8_t __order[NMEA_QUEUE_SLOTS]; /* held then pending slots, oldest first */
+  uint8_t __receive;   /* receive slot */
+  uint8_t __held;      /* nr of held slots, at the start of __order */
+  uint8_t __pending;   /* nr of pending slots, after the held ones */
+  uint8_t __highWater; /* max of __pending */
+  uint16_t __dropped;  /* sentences lost on a full queue */
+};
+
+#endif /* #ifndef __NMEAQUEUE_H__ */
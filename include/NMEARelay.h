@@ -0,0 +1,118 @@
+/**
+ * @file NMEARelay.h
+ *
+ * The definition of class NMEARelay, an interrupt driven transmitter that
+ * relays NMEA0183 sentences to the next listener on the bus.
+ *
+ * Timer1 runs at the bit rate and drives the pin through its output compare
+ * unit: every compare interrupt programs the level of the next bit, which
+ * the hardware then sets exactly at the next match, so the bits do not
+ * jitter with the other interrupts. Sentences are queued as spans, a pointer
+ * and a length, and sent straight from the memory they are in; nothing is
+ * copied and loop() never waits for the line.
+ *
+ * @author  Roy Wassili (waps61 @gmail.com)
+ * @date    2020/09/12
+ */
+#ifndef __NMEARELAY_H__
+#define __NMEARELAY_H__
+
+#include <Arduino.h>
+#include "NMEAQueue.h"
+
+/**
+ * Output pin to the next listener; must be pin 9, OC1A of Timer1.
+ */
+#define NMEA_TX_PIN 9
+
+/**
+ * Define NMEA_TX_INVERTED to idle low, so the line can drive an RS-232/NMEA
+ * level input without a level shifter, as NMEA_RX_INVERTED does for the
+ * input.
+ */
+#define NMEA_TX_INVERTED 1
+
+/**
+ * Nr of spans waiting to be sent; a power of 2 of at most 128.
+ */
+#define NMEA_TX_SPANS 8
+
+/**
+ * Nr of held spans waiting to be sent or reclaimed; held spans are slots of
+ * the NMEAQueue, so at most the slots it can spare.
+ */
+#define NMEA_TX_HELD NMEA_QUEUE_HOLD_MAX
+
+/**
+ * Interrupt driven serial transmitter, 8 data bits, no parity, 1 stop bit.
+ */
+class NMEARelay
+{
+public: /* methods */
+  /**
+   * Starts the transmitter at the given baudrate; uses Timer1. On the host
+   * the bytes go out on Serial1 at its own baudrate.
+   */
+  void begin(uint32_t baud);
+
+  /**
+   * Stops the transmitter and releases Timer1; spans still waiting are
+   * not sent, but held ones do show up in reclaim().
+   */
+  void end(void);
+
+  /**
+   * Queues bytes to be sent. They are read while they go out, so the
+   * memory must stay untouched until the span is done.
+   *
+   * @param held - count the span in reclaim() once it is sent, i.e. to
+   *  free the buffer it is in.
+   *
+   * @retval true - the span is queued.
+   * @retval false - all spans, or all NMEA_TX_HELD held ones, are in use;
+   *  the bytes are dropped and counted as an overrun, but never show up in
+   *  reclaim(), the caller still owns the buffer.
+   */
+  bool send(const char *data, uint8_t len, bool held);
+
+  /**
+   * @return true while a span of data is waiting or being sent.
+   */
+  bool sending(const char *data);
+
+  /**
+   * @return the nr of held spans done since the last call, oldest first.
+   */
+  uint8_t reclaim(void);
+
+  /**
+   * @return the nr of spans dropped because all spans, or all held ones,
+   * were in use.
+   */
+  uint16_t overruns(void);
+
+public: /* interrupt handlers, not for use by the application */
+  static void onBitTimer(void);
+
+private: /* methods */
+  static bool fetch(uint8_t *c); /* next byte to send, retires spans */
+  static void pump(void);        /* retires the spans sent on the host */
+  static void drop(void);        /* retires all spans unsent */
+
+private: /* data */
+  struct Span
+  {
+    const char *data;
+    uint8_t len;
+    bool held;
+  };
+  static volatile Span __spans[NMEA_TX_SPANS];
+  static volatile uint8_t __head;     /* written by send() only */
+  static volatile uint8_t __tail;     /* written by the interrupt only */
+  static volatile uint8_t __released; /* held spans done, by the interrupt */
+  static uint8_t __reclaimed;         /* __released seen by reclaim() */
+  static uint8_t __heldSent;          /* held spans queued by send() */
+  static uint16_t __overruns;
+};
+
+#endif /* #ifndef __NMEARELAY_H__ */
@@ -0,0 +1,141 @@
+/**
+ * @file NMEARelayPolicy.h
+ *
+ * The definition of class NMEARelayPolicy, which decides per sentence type
+ * what the relay passes on, and the table it works from.
+ *
+ * Every rule of the table matches a tag, the talker id and sentence id,
+ * and either passes, drops or thins out the sentences with that tag to at
+ * most one per interval. A rule with a generator injects a sentence of our
+ * own every interval instead. On top of that a token bucket keeps the bytes
+ * relayed under a share of what the line can carry, so a busy bus upstream,
+ * i.e. AIS and GSV traffic, never floods the listeners downstream.
+ *
+ * @author  Roy Wassili (waps61 @gmail.com)
+ * @date    2020/09/13
+ */
+#ifndef __NMEARELAYPOLICY_H__
+#define __NMEARELAYPOLICY_H__
+
+#include <Arduino.h>
+
+/**
+ * Interval of a rule relaying every sentence.
+ */
+#define NMEA_RELAY_PASS 0
+
+/**
+ * Interval of a rule relaying nothing.
+ */
+#define NMEA_RELAY_DROP 0xFFFF
+
+/**
+ * Interval of a rule relaying at most n sentences per second.
+ */
+#define NMEA_RELAY_HZ(n) (1000 / (n))
+
+/**
+ * Character in the tag of a rule matching any character, i.e. "--GSV" is
+ * GSV of any talker and "-----" any sentence.
+ */
+#define NMEA_RELAY_ANY '-'
+
+/**
+ * Bytes the relay may send back to back once the bus was quiet.
+ */
+#define NMEA_RELAY_BURST 164
+
+/**
+ * Builds a sentence to inject, without the checksum, i.e. "$PYAZR,12,3".
+ *
+ * @param buf - the buffer to write into.
+ * @param size - room in buf; the checksum, <CR><LF> and '\0' get their own.
+ *
+ * @return the nr of characters written, 0 to skip this interval.
+ */
+typedef uint8_t (*NMEAGenerator)(char *buf, uint8_t size);
+
+/**
+ * Rule of the relay table; set up with the tag, the interval and optionally
+ * the generator, i.e. {"--GGA", NMEA_RELAY_HZ(1)}; the counters start at 0.
+ */
+struct NMEARelayRule
+{
+  const char *tag;      /* 5 characters, NMEA_RELAY_ANY matches any */
+  uint16_t interval;    /* ms, NMEA_RELAY_PASS, NMEA_RELAY_DROP or NMEA_RELAY_HZ() */
+  NMEAGenerator inject; /* NULL to relay what comes in with this tag */
+  uint32_t last;        /* millis() of the last one relayed */
+  uint16_t forwarded;   /* nr of sentences relayed or injected */
+  uint16_t shed;        /* nr of sentences dropped by the interval or budget */
+
+  NMEARelayRule(const char *tag, uint16_t interval, NMEAGenerator inject = NULL)
+      : tag(tag), interval(interval), inject(inject), last(0), forwarded(0), shed(0) {}
+};
+
+class NMEARelayPolicy
+{
+public: /* methods */
+  /**
+   * @param rules - the table; the 1st rule matching a tag applies.
+   */
+  NMEARelayPolicy(NMEARelayRule *rules, uint8_t count);
+
+  /**
+   * Sets the budget and starts with a full bucket.
+   *
+   * @param baud - baudrate of the line downstream.
+   * @param budget - share of the line the relay may use, in %.
+   */
+  void begin(uint32_t baud, uint8_t budget, uint32_t now);
+
+  /**
+   * Decides on the tag alone if a sentence may be relayed, so sentences
+   * that will be dropped need not be received at all.
+   *
+   * @param tag - start delimiter and the 5 character tag.
+   */
+  bool wanted(const char *tag, uint32_t now);
+
+  /**
+   * Decides if a complete sentence is relayed and counts it.
+   *
+   * @retval true - send it and take it off the budget.
+   * @retval false - shed it.
+   */
+  bool admit(const char *sentence, uint8_t len, uint32_t now);
+
+  /**
+   * Builds the next injected sentence that is due and fits the budget. A
+   * rule whose generator writes nothing waits for its next interval.
+   *
+   * @return the length of the sentence in buf, 0 when none is due or the
+   *  budget is spent.
+   */
+  uint8_t inject(uint32_t now, char *buf, uint8_t size);
+
+  /**
+   * @return the nr of sentences relayed or injected.
+   */
+  uint16_t forwarded(void) { return __forwarded; }
+
+  /**
+   * @return the nr of complete sentences shed; the ones skipped on their
+   * tag are not counted, they never got in.
+   */
+  uint16_t shed(void) { return __shed; }
+
+private: /* methods */
+  NMEARelayRule *match(const char *tag);
+  bool spend(uint8_t len, uint32_t now);
+
+private: /* data */
+  NMEARelayRule *__rules;
+  uint8_t __count;
+  uint16_t __rate;    /* budget in bytes per second */
+  uint32_t __credit;  /* bucket content in 1/1000 bytes */
+  uint32_t __refill;  /* millis() the bucket was last filled */
+  uint16_t __forwarded;
+  uint16_t __shed;
+};
+
+#endif /* #ifndef __NMEARELAYPOLICY_H__ */
@@ -0,0 +1,88 @@
+/**
+ * @file NMEASerial.h
+ *
+ * The definition of class NMEASerial, an interrupt driven receiver for the
+ * NMEA0183 input.
+ *
+ * A pin-change interrupt catches the start bit, after which Timer2 samples
+ * the bits in the middle of each bit period. Received bytes go into a
+ * lock-free single producer, single consumer ring buffer which is emptied
+ * from loop(). Unlike SoftwareSerial interrupts stay enabled while a byte
+ * comes in, so the hardware UART to the Nextion keeps running.
+ *
+ * @author  Roy Wassili (waps61 @gmail.com)
+ * @date    2020/08/31
+ */
+#ifndef __NMEASERIAL_H__
+#define __NMEASERIAL_H__
+
+#include <Arduino.h>
+
+/**
+ * Input pin of the NMEA talker; must be one of the pins 8-13 (port B) as
+ * those share the pin-change interrupt handled here.
+ */
+#define NMEA_RX_PIN 10
+
+/**
+ * Define NMEA_RX_INVERTED when the line idles low, as is the case when
+ * an RS-232/NMEA level signal is connected without a level shifter.
+ */
+#define NMEA_RX_INVERTED 1
+
+/**
+ * Size of the receive ring buffer; a power of 2 of at most 128.
+ */
+#define NMEA_RX_BUFFER_SIZE 128
+
+/**
+ * Interrupt driven serial receiver, 8 data bits, no parity, 1 stop bit.
+ * Sustains 38400 Bd on a 16 MHz board.
+ */
+class NMEASerial
+{
+public: /* methods */
+  /**
+   * Starts receiving at the given baudrate; uses Timer2.
+   */
+  void begin(uint32_t baud);
+
+  /**
+   * Stops receiving and releases Timer2 and the pin-change interrupt.
+   */
+  void end(void);
+
+  /**
+   * @return the nr of bytes waiting in the ring buffer.
+   */
+  int available(void);
+
+  /**
+   * @return the oldest byte in the ring buffer or -1 if it is empty.
+   */
+  int read(void);
+
+  /**
+   * @return the nr of bytes lost because the ring buffer was full.
+   */
+  uint16_t overflows(void);
+
+  /**
+   * @return the nr of bytes dropped on a missing stop bit.
+   */
+  uint16_t framingErrors(void);
+
+public: /* interrupt handlers, not for use by the application */
+  static void onPinChange(void);
+  static void onBitTimer(void);
+  static void onByte(uint8_t c); /* stores a received byte */
+
+private: /* data */
+  static volatile uint8_t __buffer[NMEA_RX_BUFFER_SIZE];
+  static volatile uint8_t __head; /* written by the interrupt only */
+  static volatile uint8_t __tail; /* written by read() only */
+  static volatile uint16_t __overflows;
+  static volatile uint16_t __framingErrors;
+};
+
+#endif /* #ifndef __NMEASERIAL_H__ */
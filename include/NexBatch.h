@@ -0,0 +1,92 @@
+/**
+ * @file NexBatch.h
+ *
+ * The definition of class NexBatch.
+ *
+ * @author  Roy Wassili (waps61 @gmail.com)
+ * @date    2020/09/08
+ */
+#ifndef __NEXBATCH_H__
+#define __NEXBATCH_H__
+
+#include "NexObject.h"
+#include "NexHardware.h"
+/**
+ * @addtogroup Component
+ * @{
+ */
+
+/**
+ * Collects attribute writes to any number of components and sends them to
+ * Nextion as one burst with a single completion check, so updating a page
+ * costs one link latency instead of one per write.
+ *
+ * Nothing is copied: the objects, attribute names and texts passed must
+ * stay valid until flush().
+ */
+class NexBatch
+{
+public: /* methods */
+    /**
+     * Constructor.
+     *
+     * @param hold_refresh - wrap the writes in ref_stop/ref_star, so the
+     *  page is redrawn once with all of them.
+     */
+    NexBatch(bool hold_refresh = false);
+
+    /**
+     * Add a write of a numeric attribute, i.e. add(gauge, "val", 90).
+     *
+     * @retval true - success.
+     * @retval false - the batch is full.
+     */
+    bool add(NexObject &obj, const char *attr, uint32_t number);
+
+    /**
+     * Add a write of a text attribute, i.e. add(text, "txt", "12.3").
+     *
+     * @retval true - success.
+     * @retval false - the batch is full.
+     */
+    bool add(NexObject &obj, const char *attr, const char *text);
+
+    bool setValue(NexObject &obj, uint32_t number) { return add(obj, "val", number); }
+    bool setPic(NexObject &obj, uint32_t number) { return add(obj, "pic", number); }
+    bool setText(NexObject &obj, const char *text) { return add(obj, "txt", text); }
+
+    /**
+     * @return the nr of writes collected.
+     */
+    uint8_t count(void) { return __count; }
+
+    /**
+     * Send all writes collected back to back and wait until Nextion has
+     * executed them. The batch is empty afterwards.
+     *
+     * @param timeout - set timeout time for the whole batch.
+     *
+     * @retval true - all writes were executed.
+     * @retval false - Nextion replied an error or did not finish in time.
+     */
+    bool flush(uint32_t timeout = 100);
+
+private: /* data */
+    struct Write
+    {
+        NexObject *obj;
+        const char *attr;
+        const char *text;   /* NULL for a numeric attribute */
+        uint32_t number;
+    };
+
+    Write __writes[NEX_BATCH_SIZE];
+    uint8_t __count;
+    bool __hold_refresh;
+};
+
+/**
+ * @}
+ */
+
+#endif /* #ifndef __NEXBATCH_H__ */
@@ -36,6 +36,63 @@
  */
 #define nexSerial Serial
 
+/**
+ * Define NEX_CACHE_ENABLE to give every component an attribute cache, see
+ * NexObject::setCacheMode(). It costs 7 bytes of RAM per component, so
+ * it is left out unless a component needs it. 
+ */
+//#define NEX_CACHE_ENABLE
+
+
+/**
+ * Baudrates nexInit() probes Nextion at, fastest first; Nextion is moved to
+ * the fastest one that passes a round trip test. Only list rates the wiring
+ * sustains: baud= does not persist, but a panel moved to a rate the link
+ * cannot carry may only come back after a power cycle. 
+ */
+#define NEX_BAUD_RATES      115200, 57600, 38400, 19200, 9600
+
+/**
+ * Time in ms to wait for the round trip test at a baudrate. 
+ */
+#define NEX_BAUD_TIMEOUT    100
+
+/**
+ * Response mode (bkcmd) set by nexInit(); one of the NEX_BKCMD_ values. 
+ */
+#define NEX_RESPONSE_MODE   NEX_BKCMD_SUCCESS
+
+/**
+ * Nr of commands nexQueueCommand() can hold, including the one in flight.
+ */
+#define NEX_CMD_QUEUE_SIZE  4
+
+/**
+ * Max length of a queued command, including the terminating '\0'.
+ */
+#define NEX_CMD_MAX_LEN     24
+
+/**
+ * Time in ms within which a queued command has to be acknowledged. Without
+ * success replies (bkcmd=0/2) a command counts as done once this time has
+ * passed without an error. 
+ */
+#define NEX_CMD_TIMEOUT     20
+
+/**
+ * Nr of attribute writes a NexBatch can collect. 
+ */
+#define NEX_BATCH_SIZE      8
+
+/**
+ * Max payload of a number or string reply; longer strings are truncated. 
+ */
+#define NEX_REPLY_MAX_LEN   20
+
+/**
+ * Nr of touch events and of system events kept until they are collected. 
+ */
+#define NEX_EVENT_QUEUE_SIZE    4
 
 #ifdef DEBUG_SERIAL_ENABLE
 #define dbSerialPrint(a)    dbSerial.print(a)
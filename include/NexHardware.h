@@ -24,16 +24,73 @@
  */
 
 /**
- * Init Nextion.  
+ * Response modes of Nextion (bkcmd), selecting which commands get a reply. 
+ * NEX_BKCMD_SUCCESS and NEX_BKCMD_ERRORS are bits of NEX_BKCMD_ALL. 
+ */
+#define NEX_BKCMD_NONE      (0)     /* no replies at all */
+#define NEX_BKCMD_SUCCESS   (1)     /* reply on success only */
+#define NEX_BKCMD_ERRORS    (2)     /* reply on errors only */
+#define NEX_BKCMD_ALL       (3)     /* reply on success and errors */
+
+/**
+ * Init Nextion: negotiate the baudrate with nexNegotiateBaud() and set the
+ * response mode to NEX_RESPONSE_MODE.  
  * 
  * @return true if success, false for failure. 
  */
 bool nexInit(void);
 
+/**
+ * Find the baudrate Nextion runs at by probing the NEX_BAUD_RATES, then move
+ * it to the fastest of them that passes a round trip test, and measure the
+ * latency of the link at that rate. 
+ *
+ * @return the baudrate used or 0 when Nextion did not answer. 
+ */
+uint32_t nexNegotiateBaud(void);
+
+/**
+ * @return the baudrate negotiated, 0 if none. 
+ */
+uint32_t nexBaud(void);
+
+/**
+ * Get the latency of the link measured by nexNegotiateBaud(): the time from
+ * sending a short command until its reply is received. Use it to choose
+ * how often to update the display. 
+ *
+ * @return the latency in us, 0 if not measured. 
+ */
+uint32_t nexLatency(void);
+
+/**
+ * Set the response mode (bkcmd) of Nextion. 
+ *
+ * All functions follow the mode. Without success replies
+ * recvRetCommandFinished() cannot wait for one: with bkcmd=0 it returns
+ * at once, with bkcmd=2 it confirms the command with nexSync(), which
+ * costs a round trip and a sendme per blocking setter. Queued commands
+ * without a success reply count as done when no error comes within
+ * NEX_CMD_TIMEOUT, or when the reply to a sendme queued after them comes
+ * in. Queued commands are sent one at a time, so an error is always
+ * matched to the command it is for. 
+ *
+ * @param mode - one of the NEX_BKCMD_ values. 
+ *
+ * @return true if success, false for failure. 
+ */
+bool nexSetResponseMode(uint8_t mode);
+
+/**
+ * @return the current response mode, one of the NEX_BKCMD_ values. 
+ */
+uint8_t nexResponseMode(void);
+
 /**
  * Listen touch event and calling callbacks attached before.
  * 
- * Supports push and pop at present. 
+ * Supports push and pop at present. Touch events are taken from the queue
+ * filled by all functions reading from Nextion. 
  *
  * @param nex_listen_list - index to Nextion Components list. 
  * @return none. 
@@ -43,6 +100,152 @@ bool nexInit(void);
  */
 void nexLoop(NexTouch *nex_listen_list[]);
 
+/**
+ * Frame heads of the events Nextion sends on its own. 
+ */
+#define NEX_EVENT_TOUCH             (0x65)  /* data: page id, component id, press/release */
+#define NEX_EVENT_PAGE              (0x66)  /* data: page id */
+#define NEX_EVENT_POSITION          (0x67)  /* data: x, y (msb first), press/release */
+#define NEX_EVENT_SLEEP_POSITION    (0x68)  /* data: as NEX_EVENT_POSITION */
+#define NEX_EVENT_LAUNCHED          (0x88)  /* no data */
+#define NEX_EVENT_UPGRADED          (0x89)  /* no data */
+
+/**
+ * An event received from Nextion. 
+ */
+struct NexEvent
+{
+    uint8_t head;       /* one of the NEX_EVENT_ heads */
+    uint8_t data[5];    /* payload as received, 0 past its end */
+};
+
+/**
+ * Get the oldest touch event (NEX_EVENT_TOUCH, NEX_EVENT_POSITION,
+ * NEX_EVENT_SLEEP_POSITION) received. 
+ *
+ * All functions reading from Nextion route its frames to separate queues,
+ * so events arriving while waiting for a reply are kept. 
+ *
+ * @param ev - receives the event. 
+ *
+ * @retval true - ev holds the event. 
+ * @retval false - there is none. 
+ */
+bool nexGetTouchEvent(NexEvent *ev);
+
+/**
+ * Get the oldest system event (any event that is no touch event, i.e.
+ * NEX_EVENT_LAUNCHED or a page id sent by sendme) received. 
+ *
+ * @param ev - receives the event. 
+ *
+ * @retval true - ev holds the event. 
+ * @retval false - there is none. 
+ */
+bool nexGetSystemEvent(NexEvent *ev);
+
+/**
+ * Get the generation of the attribute caches of the components. 
+ *
+ * A cached attribute is only valid when it was stored in the current
+ * generation. A new one starts on nexInit(), when Nextion resets, when
+ * a page command is sent and when Nextion reports another page (by
+ * sendme or in a touch event). 
+ *
+ * @return the generation, never 0. 
+ */
+uint16_t nexCacheGeneration(void);
+
+/**
+ * Start a new cache generation, invalidating all cached attributes. 
+ */
+void nexCacheInvalidate(void);
+
+/**
+ * Wait until Nextion has executed every command sent so far. 
+ *
+ * Sends sendme, which Nextion answers with the current page id whatever
+ * the response mode, and as commands are executed in order the page id
+ * comes after the replies to all earlier commands. 
+ *
+ * @param errors - receives the nr of error replies received meanwhile,
+ *  may be NULL; they are counted as they come in, so any nr of replies
+ *  fits. 
+ * @param timeout - set timeout time. 
+ *
+ * @retval true - the page id was received. 
+ * @retval false - timed out. 
+ */
+bool nexSync(uint8_t *errors, uint32_t timeout = 100);
+
+/**
+ * Status passed to a NexAckCb: the command finished. Any other status
+ * below NEX_ACK_TIMEOUT is the error code returned by Nextion. 
+ */
+#define NEX_ACK_OK          (0x01)
+
+/**
+ * Status passed to a NexAckCb: no reply within NEX_CMD_TIMEOUT. 
+ */
+#define NEX_ACK_TIMEOUT     (0xFF)
+
+/**
+ * Type of callback function called when a queued command is acknowledged,
+ * failed or timed out. 
+ * 
+ * @param status - NEX_ACK_OK, NEX_ACK_TIMEOUT or the Nextion error code. 
+ * @param ptr - user pointer passed to nexQueueCommand(). 
+ */
+typedef void (*NexAckCb)(uint8_t status, void *ptr);
+
+/**
+ * Queue a command to be sent by nexPoll() without waiting for its reply. 
+ *
+ * Commands are sent in order, each one after the previous one has been
+ * acknowledged or timed out. A "sendme" is a marker: it completes on the
+ * page id Nextion sends back, and without success replies it is sent right
+ * after the command before it, which is then done as soon as the page id
+ * comes in without an error before it. 
+ *
+ * @param cmd - the command, at most NEX_CMD_MAX_LEN - 1 characters. 
+ * @param cb - called with the outcome of the command, may be NULL. 
+ * @param ptr - passed to cb. 
+ *
+ * @retval true - the command is queued. 
+ * @retval false - the queue is full or the command is too long. 
+ */
+bool nexQueueCommand(const char *cmd, NexAckCb cb = NULL, void *ptr = NULL);
+
+/**
+ * Send queued commands and handle their replies; never blocks.
+ *
+ * @warning Call it from your loop function. Do not use the blocking
+ *  sendCommand()/recvRet* functions while commands are queued. 
+ */
+void nexPoll(void);
+
+/**
+ * @return the nr of queued commands, including the one in flight. 
+ */
+uint8_t nexPending(void);
+
+/**
+ * Counters of the command pipeline. 
+ */
+struct NexLinkStats
+{
+    uint16_t acked;     /* commands finished */
+    uint16_t failed;    /* commands answered with an error code */
+    uint16_t timeouts;  /* commands without a reply in time */
+    uint16_t late;      /* replies that came after their timeout or were never collected */
+    uint16_t dropped;   /* events lost on a full queue */
+};
+
+/**
+ * @return the counters of the command pipeline. 
+ */
+const NexLinkStats *nexLinkStats(void);
+
 /**
  * @}
  */
@@ -50,6 +253,16 @@ void nexLoop(NexTouch *nex_listen_list[]);
 bool recvRetNumber(uint32_t *number, uint32_t timeout = 100);
 uint16_t recvRetString(char *buffer, uint16_t len, uint32_t timeout = 100);
 void sendCommand(const char* cmd);
+
+/**
+ * Send a command to Nextion in parts, streamed straight to the port so it
+ * is never assembled in memory: sendCommandBegin(), then sendCommandAdd()
+ * for every part and sendCommandEnd() to terminate it. 
+ */
+void sendCommandBegin(void);
+void sendCommandAdd(const char *str);
+void sendCommandAdd(uint32_t number);
+void sendCommandEnd(void);
 bool recvRetCommandFinished(uint32_t timeout = 100);
 
 #endif /* #ifndef __NEXHARDWARE_H__ */
@@ -17,6 +17,13 @@
 #define __NEXOBJECT_H__
 #include <Arduino.h>
 #include "NexConfig.h"
+
+/**
+ * Cache modes of a component, see NexObject::setCacheMode(). 
+ */
+#define NEX_CACHE_OFF       (0)     /* always talk to Nextion */
+#define NEX_CACHE_WRITES    (1)     /* skip writes of the value Nextion already has */
+#define NEX_CACHE_ALL       (2)     /* also answer reads from the cache */
 /**
  * @addtogroup CoreAPI 
  * @{ 
@@ -31,6 +38,8 @@
  */
 class NexObject 
 {
+    friend class NexBatch;
+
 public: /* methods */
 
     /**
@@ -49,6 +58,20 @@ public: /* methods */
      */
     void printObjInfo(void);
 
+    /**
+     * Set how the numeric attribute of the component (val, pic or picc)
+     * is cached. The cache holds the last value Nextion confirmed and is
+     * invalidated on a reset or page change, see nexCacheGeneration(). 
+     *
+     * Only use NEX_CACHE_ALL for components that Nextion never changes
+     * on its own, i.e. not for sliders or values set by the HMI code. 
+     *
+     * @param mode - one of the NEX_CACHE_ values, NEX_CACHE_OFF by default. 
+     *
+     * @warning this method does nothing, unless NEX_CACHE_ENABLE is defined. 
+     */
+    void setCacheMode(uint8_t mode);
+
 protected: /* methods */
 
     /*
@@ -71,11 +94,36 @@ protected: /* methods */
      * @return the name of component. 
      */
     const char *getObjName(void);    
+
+    /*
+     * Get the numeric attribute from the cache. 
+     *
+     * @retval true - number holds the cached value. 
+     * @retval false - it has to be read from Nextion. 
+     */
+    bool cacheRead(uint32_t *number);
+
+    /*
+     * @retval true - Nextion already has number, so writing it is redundant. 
+     */
+    bool cacheHit(uint32_t number);
+
+    /*
+     * Record the outcome of reading or writing the numeric attribute. 
+     *
+     * @param ok - Nextion confirmed number; otherwise its value is unknown. 
+     */
+    void cacheStore(bool ok, uint32_t number);
     
 private: /* data */ 
     uint8_t __pid; /* Page ID */
     uint8_t __cid; /* Component ID */
     const char *__name; /* An unique name */
+#ifdef NEX_CACHE_ENABLE
+    uint8_t __cache_mode; /* NEX_CACHE_ value */
+    uint16_t __cache_gen; /* generation __cache was stored in, 0 = invalid */
+    uint32_t __cache; /* last value confirmed */
+#endif
 };
 /**
  * @}
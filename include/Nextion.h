@@ -22,6 +22,7 @@
 #include "NexTouch.h"
 #include "NexHardware.h"
 
+#include "NexBatch.h"
 #include "NexButton.h"
 #include "NexCrop.h"
 #include "NexGauge.h"
@@ -0,0 +1,87 @@
+/**
+ * @file RefreshScheduler.h
+ *
+ * The definition of class RefreshScheduler, a token bucket deciding when
+ * the next display update may be sent.
+ *
+ * The bucket fills at one token per refresh interval and holds at most
+ * REFRESH_BURST tokens, so a change after a quiet spell is sent at once
+ * while a steady stream of changes is paced at the interval. The interval
+ * adapts to the link: it closes in on the larger of the minimum interval
+ * and the measured ack latency while updates are acknowledged, and doubles
+ * on every update that fails or times out.
+ *
+ * @author  Roy Wassili (waps61 @gmail.com)
+ * @date    2020/09/09
+ */
+#ifndef __REFRESHSCHEDULER_H__
+#define __REFRESHSCHEDULER_H__
+
+#include <Arduino.h>
+
+/**
+ * Nr of updates the bucket can hold, i.e. send back to back after a quiet
+ * spell.
+ */
+#define REFRESH_BURST 2
+
+class RefreshScheduler
+{
+public: /* methods */
+  /**
+   * @param minInterval - shortest interval in ms, i.e. the refresh period
+   *  of the HMI; updates sent faster would never be shown.
+   * @param maxInterval - longest interval in ms to back off to.
+   */
+  RefreshScheduler(uint16_t minInterval, uint16_t maxInterval);
+
+  /**
+   * Starts with a full bucket and the interval for the given latency.
+   *
+   * @param now - millis().
+   * @param latency - round trip of the link in us, i.e. nexLatency().
+   */
+  void begin(uint32_t now, uint32_t latency);
+
+  /**
+   * @return true when an update may be sent now.
+   */
+  bool ready(uint32_t now);
+
+  /**
+   * Takes a token for the update sent now.
+   */
+  void sent(uint32_t now);
+
+  /**
+   * Feeds back the outcome of the last update sent.
+   *
+   * @param ok - the update was acknowledged, false on an error or timeout.
+   * @param replied - false when the ack was no reply of the HMI but the
+   *  lack of an error in time (bkcmd=0/2); that time says nothing of the
+   *  link, so it is left out of the latency.
+   */
+  void done(uint32_t now, bool ok, bool replied = true);
+
+  /**
+   * @return the current refresh interval in ms.
+   */
+  uint16_t interval(void) { return __interval; }
+
+  /**
+   * @return the running average of the time in ms until an update is
+   * acknowledged.
+   */
+  uint16_t latency(void) { return __latency >> 3; }
+
+private: /* data */
+  uint16_t __min;
+  uint16_t __max;
+  uint16_t __interval; /* ms per token */
+  uint16_t __latency;  /* running average in 1/8 ms */
+  uint16_t __credit;   /* bucket content in ms, a token is __interval */
+  uint32_t __refill;   /* millis() the bucket was last filled */
+  uint32_t __sentAt;   /* millis() the last update was sent */
+};
+
+#endif /* #ifndef __REFRESHSCHEDULER_H__ */
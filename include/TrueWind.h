@@ -0,0 +1,62 @@
+/**
+ * @file TrueWind.h
+ *
+ * True wind speed, angle and direction from the apparent wind and the
+ * speed and course over ground.
+ *
+ * The apparent wind is a vector in the frame of the boat, x along the bow
+ * and y to starboard. Taking off the wind of the boat's own motion, SOG
+ * along the bow, leaves the true wind:
+ *   x = AWS * cos(AWA) - SOG,  y = AWS * sin(AWA)
+ *   TWA = atan2(y, x),  TWS = |(x, y)|,  TWD = COG + TWA
+ * There is no log or compass on the bus, so SOG stands in for the speed
+ * through the water and COG for the heading; strictly this is the wind
+ * over the ground. The maths uses the fixed-point tables of WindMath.h,
+ * the length of (x, y) is its projection on the angle atan2 found.
+ *
+ * @author  Roy Wassili (waps61 @gmail.com)
+ * @date    2020/09/11
+ */
+#ifndef __TRUEWIND_H__
+#define __TRUEWIND_H__
+
+#include <Arduino.h>
+#include "WindState.h"
+
+/**
+ * The inputs of the last computation, so it is only redone when one of
+ * them changes.
+ */
+struct TrueWindInput
+{
+  int16_t awa;
+  int16_t aws;
+  int16_t sog;
+  int16_t cog;
+  uint8_t valid; /* bit per input, in the order above */
+};
+
+/**
+ * Computes the true wind, all values in tenths.
+ *
+ * @param awa - apparent wind angle -1800..1800, negative is port.
+ * @param aws - apparent wind speed 0..WIND_VALUE_MAX.
+ * @param sog - speed over ground 0..WIND_VALUE_MAX.
+ * @param cog - course over ground 0..3599.
+ * @param tws - true wind speed, 0..WIND_VALUE_MAX.
+ * @param twa - true wind angle -1800..1800, negative is port.
+ * @param twd - true wind direction 0..3599.
+ */
+void trueWindSolve(int16_t awa, int16_t aws, int16_t sog, int16_t cog,
+                   int16_t *tws, int16_t *twa, int16_t *twd);
+
+/**
+ * Updates tws, twa and twd of the state when awa, aws, sog or cog changed
+ * since the last call. TWS and TWA need awa, aws and sog to be valid, TWD
+ * also needs cog.
+ *
+ * @return true when the true wind was computed.
+ */
+bool trueWindUpdate(TrueWindInput *last, WindState *w, uint32_t now);
+
+#endif /* #ifndef __TRUEWIND_H__ */
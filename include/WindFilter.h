@@ -0,0 +1,77 @@
+/**
+ * @file WindFilter.h
+ *
+ * Damping filters for the values shown on the display.
+ *
+ * Both filters are exponential moving averages with a time constant in ms,
+ * weighted by the time since the previous sample, so talkers sending at
+ * different rates are damped alike. Angles are averaged as unit vectors
+ * (sin, cos) and turned back into an angle with windAtan2(), so averaging
+ * across 359 -> 0 or +180 -> -180 does what it should. All maths is fixed
+ * point.
+ *
+ * A filter restarts from the next sample when it was not fed for 4 time
+ * constants, so it never drags an old value along after a gap.
+ *
+ * Set up a filter with its time constant only, i.e.
+ *   WindAngleFilter awaFilter(1000);
+ *
+ * @author  Roy Wassili (waps61 @gmail.com)
+ * @date    2020/09/10
+ */
+#ifndef __WINDFILTER_H__
+#define __WINDFILTER_H__
+
+#include <Arduino.h>
+#include "WindState.h"
+
+/**
+ * Damping of a value like a speed, in tenths.
+ */
+struct WindScalarFilter
+{
+  uint16_t tau;     /* time constant in ms, 0 = no damping */
+  bool primed;      /* false until the 1st sample */
+  uint32_t updated; /* millis() of the last sample */
+  int32_t value;    /* average in 1/8 tenths */
+
+  explicit WindScalarFilter(uint16_t tau)
+      : tau(tau), primed(false), updated(0), value(0) {}
+};
+
+/**
+ * Damping of an angle, in tenths of a degree.
+ */
+struct WindAngleFilter
+{
+  uint16_t tau;     /* time constant in ms, 0 = no damping */
+  bool primed;      /* false until the 1st sample */
+  uint32_t updated; /* millis() of the last sample */
+  int32_t x;        /* average cos, Q18 */
+  int32_t y;        /* average sin, Q18 */
+
+  explicit WindAngleFilter(uint16_t tau)
+      : tau(tau), primed(false), updated(0), x(0), y(0) {}
+};
+
+/**
+ * Feeds a sample into the filter.
+ *
+ * @param value - the sample in tenths, 0..WIND_VALUE_MAX.
+ * @param now - millis() of the sample.
+ *
+ * @return the damped value in tenths.
+ */
+int16_t windFilter(WindScalarFilter *f, int16_t value, uint32_t now);
+
+/**
+ * Feeds a sample into the filter.
+ *
+ * @param tenths - the angle in tenths of a degree, any range.
+ * @param now - millis() of the sample.
+ *
+ * @return the damped angle in tenths of a degree, 0..3599.
+ */
+int16_t windFilter(WindAngleFilter *f, int16_t tenths, uint32_t now);
+
+#endif /* #ifndef __WINDFILTER_H__ */
@@ -0,0 +1,49 @@
+/**
+ * @file WindMath.h
+ *
+ * Fixed-point trigonometry on angles in tenths of a degree, the unit of
+ * the WindState; no floating point, the lookup tables live in flash.
+ *
+ * sin and cos are interpolated from a table of whole degrees and returned
+ * in Q15 (32767 = 1.0), the error is below 0.0001. atan2 is interpolated
+ * from a table of 65 tangents and is accurate to 0.1 degree.
+ *
+ * @author  Roy Wassili (waps61 @gmail.com)
+ * @date    2020/09/10
+ */
+#ifndef __WINDMATH_H__
+#define __WINDMATH_H__
+
+#include <Arduino.h>
+#include "WindState.h"
+
+/**
+ * Value of 1.0 in the Q15 results of windSin() and windCos().
+ */
+#define WIND_Q15 32767
+
+/**
+ * @return the angle in 0..3599.
+ */
+int16_t windNormalize(int16_t tenths);
+
+/**
+ * @return sin of an angle in tenths of a degree, Q15.
+ */
+int16_t windSin(int16_t tenths);
+
+/**
+ * @return cos of an angle in tenths of a degree, Q15.
+ */
+int16_t windCos(int16_t tenths);
+
+/**
+ * Angle of the vector (x, y), counter clockwise from the x axis, so that
+ * windAtan2(windSin(a), windCos(a)) gives a back. Any scale of x and y
+ * will do.
+ *
+ * @return the angle in tenths of a degree 0..3599, 0 for a zero vector.
+ */
+int16_t windAtan2(int32_t y, int32_t x);
+
+#endif /* #ifndef __WINDMATH_H__ */
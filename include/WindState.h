@@ -0,0 +1,79 @@
+/**
+ * @file WindState.h
+ *
+ * The wind and course data as decoded from the NMEA sentences.
+ *
+ * All values are fixed-point integers in tenths, written straight by the
+ * sentence decoders and read by the display code, so there are no string
+ * conversions between receiving a value and showing it.
+ *
+ * @author  Roy Wassili (waps61 @gmail.com)
+ * @date    2020/09/06
+ */
+#ifndef __WINDSTATE_H__
+#define __WINDSTATE_H__
+
+#include <Arduino.h>
+
+/**
+ * Largest value a field can hold, in tenths.
+ */
+#define WIND_VALUE_MAX 32767
+
+/**
+ * A single value with its validity and age.
+ */
+struct WindValue
+{
+  int16_t value;    /* in tenths of the unit of the field */
+  bool valid;       /* false until set or when the talker flags it invalid */
+  uint32_t updated; /* millis() of the last update */
+};
+
+/**
+ * The complete state shown by the display. The true wind is not decoded
+ * but derived from the other values by trueWindUpdate().
+ */
+struct WindState
+{
+  WindValue awa; /* apparent wind angle 0.1 deg, -1800..1800, negative is port */
+  WindValue aws; /* apparent wind speed 0.1 kts */
+  WindValue sog; /* speed over ground 0.1 kts */
+  WindValue cog; /* course over ground 0.1 deg, 0..3599 */
+  WindValue tws; /* true wind speed 0.1 kts, see TrueWind.h */
+  WindValue twa; /* true wind angle 0.1 deg, -1800..1800, negative is port */
+  WindValue twd; /* true wind direction 0.1 deg, 0..3599 */
+  uint32_t stamp; /* micros() the '$' of the newest sentence with a value arrived */
+};
+
+/**
+ * Stores a new value and marks it valid.
+ */
+inline void windSet(WindValue *v, int16_t value, uint32_t now)
+{
+  v->value = value;
+  v->valid = true;
+  v->updated = now;
+}
+
+/**
+ * Marks a value invalid; the last valid value is kept.
+ */
+inline void windInvalidate(WindValue *v, uint32_t now)
+{
+  v->valid = false;
+  v->updated = now;
+}
+
+/**
+ * Rounds a value in tenths to whole units, half away from zero, without a
+ * division; exact for the range of an int16_t.
+ */
+inline int16_t windUnits(int16_t tenths)
+{
+  if (tenths < 0)
+    return -(int16_t)(((uint32_t)(5L - tenths) * 52429UL) >> 19);
+  return (int16_t)(((uint32_t)(tenths + 5L) * 52429UL) >> 19);
+}
+
+#endif /* #ifndef __WINDSTATE_H__ */
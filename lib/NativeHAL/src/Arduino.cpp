@@ -0,0 +1,111 @@
+/**
+ * @file Arduino.cpp
+ *
+ * Host implementation of the Arduino core functions.
+ *
+ * @author  Roy Wassili (waps61 @gmail.com)
+ * @date    2020/09/05
+ */
+#include "Arduino.h"
+
+/* reading the clock costs 1 us, so a busy wait on millis() always ends */
+#define CLOCK_READ_COST 1
+
+static uint64_t now = 0;
+static uint8_t pins[32];
+
+uint64_t halNow(void)
+{
+  return now;
+}
+
+void halAdvance(uint64_t us)
+{
+  now += us;
+}
+
+void halAdvanceTo(uint64_t t)
+{
+  if (t > now)
+    now = t;
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+  if (pin < sizeof(pins) && mode == INPUT_PULLUP)
+    pins[pin] = HIGH;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+  if (pin < sizeof(pins))
+    pins[pin] = val;
+}
+
+int digitalRead(uint8_t pin)
+{
+  return pin < sizeof(pins) ? pins[pin] : LOW;
+}
+
+unsigned long millis(void)
+{
+  now += CLOCK_READ_COST;
+  return (unsigned long)(uint32_t)(now / 1000);
+}
+
+unsigned long micros(void)
+{
+  now += CLOCK_READ_COST;
+  return (unsigned long)(uint32_t)now;
+}
+
+void delay(unsigned long ms)
+{
+  now += (uint64_t)ms * 1000;
+}
+
+void delayMicroseconds(unsigned int us)
+{
+  now += us;
+}
+
+char *ultoa(unsigned long value, char *str, int base)
+{
+  char tmp[33];
+  int i = 0;
+  int j = 0;
+
+  do
+  {
+    int d = value % base;
+    tmp[i++] = d < 10 ? '0' + d : 'a' + d - 10;
+    value /= base;
+  } while (value > 0 && i < 32);
+  while (i > 0)
+    str[j++] = tmp[--i];
+  str[j] = '\0';
+  return str;
+}
+
+char *ltoa(long value, char *str, int base)
+{
+  if (value < 0 && base == 10)
+  {
+    str[0] = '-';
+    ultoa(-(unsigned long)value, str + 1, base);
+    return str;
+  }
+  return ultoa((unsigned long)value, str, base);
+}
+
+char *itoa(int value, char *str, int base)
+{
+  if (base != 10)
+    return ultoa((unsigned int)value, str, base); // avr-libc: two's complement
+  return ltoa(value, str, base);
+}
+
+char *utoa(unsigned int value, char *str, int base)
+{
+  return ultoa(value, str, base);
+}
@@ -0,0 +1,78 @@
+/**
+ * @file Arduino.h
+ *
+ * Host stand-in for the Arduino core, used by the native environment.
+ *
+ * Time is virtual: micros() and millis() return the simulated time, which
+ * moves forward on delay(), on every clock read and when the driver idles
+ * the loop. So the firmware sees the same pacing as on the board, only
+ * faster, and a run over a captured log is reproducible.
+ *
+ * @author  Roy Wassili (waps61 @gmail.com)
+ * @date    2020/09/05
+ */
+#ifndef __ARDUINO_H__
+#define __ARDUINO_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "WString.h"
+#include "HostSerial.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+#define F(s) (s)
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+char *itoa(int value, char *str, int base);
+char *utoa(unsigned int value, char *str, int base);
+char *ltoa(long value, char *str, int base);
+char *ultoa(unsigned long value, char *str, int base);
+
+/**
+ * @return the virtual time in microseconds since start, without wrapping
+ * and without moving the clock.
+ */
+uint64_t halNow(void);
+
+/**
+ * Moves the virtual clock forward by us microseconds.
+ */
+void halAdvance(uint64_t us);
+
+/**
+ * Moves the virtual clock forward to t, if t is in the future.
+ */
+void halAdvanceTo(uint64_t t);
+
+/**
+ * Firmware entry points, implemented by the sketch.
+ */
+void setup(void);
+void loop(void);
+
+#endif /* #ifndef __ARDUINO_H__ */
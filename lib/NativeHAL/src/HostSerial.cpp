@@ -0,0 +1,178 @@
+/**
+ * @file HostSerial.cpp
+ *
+ * The implementation of class HostSerial.
+ *
+ * @author  Roy Wassili (waps61 @gmail.com)
+ * @date    2020/09/05
+ */
+#include "Arduino.h"
+
+HostSerial Serial;
+HostSerial Serial1;
+
+HostSerial *HostSerial::__ports = NULL;
+
+HostSerial::HostSerial(void)
+{
+  __rxLast = 0;
+  __txDoneAt = 0;
+  __baud = 9600;
+  __timeout = 1000;
+  __txCb = NULL;
+  __txCtx = NULL;
+  __next = __ports;
+  __ports = this;
+}
+
+void HostSerial::begin(unsigned long baud)
+{
+  __baud = baud;
+}
+
+void HostSerial::end(void)
+{
+}
+
+int HostSerial::available(void)
+{
+  uint64_t now = halNow();
+  int n = 0;
+
+  for (std::deque<Pending>::iterator it = __rx.begin(); it != __rx.end() && it->at <= now; ++it)
+    n++;
+  return n;
+}
+
+int HostSerial::read(void)
+{
+  int c;
+
+  if (__rx.empty() || __rx.front().at > halNow())
+    return -1;
+  c = __rx.front().c;
+  __rx.pop_front();
+  return c;
+}
+
+int HostSerial::peek(void)
+{
+  if (__rx.empty() || __rx.front().at > halNow())
+    return -1;
+  return __rx.front().c;
+}
+
+void HostSerial::flush(void)
+{
+  halAdvanceTo(__txDoneAt);
+}
+
+void HostSerial::setTimeout(unsigned long timeout)
+{
+  __timeout = timeout;
+}
+
+size_t HostSerial::readBytes(char *buffer, size_t length)
+{
+  uint64_t deadline = halNow() + (uint64_t)__timeout * 1000;
+  size_t n = 0;
+
+  // as Stream::readBytes(); wait for each byte until the timeout expires
+  while (n < length)
+  {
+    if (!__rx.empty() && __rx.front().at <= deadline)
+    {
+      halAdvanceTo(__rx.front().at);
+      buffer[n++] = (char)read();
+    }
+    else
+    {
+      halAdvanceTo(deadline);
+      break;
+    }
+  }
+  return n;
+}
+
+size_t HostSerial::write(uint8_t c)
+{
+  uint64_t start = __txDoneAt > halNow() ? __txDoneAt : halNow();
+
+  __txDoneAt = start + byteTime();
+  if (__txCb)
+    __txCb(c, __txDoneAt, __txCtx);
+  return 1;
+}
+
+size_t HostSerial::write(const uint8_t *buffer, size_t size)
+{
+  for (size_t i = 0; i < size; i++)
+    write(buffer[i]);
+  return size;
+}
+
+size_t HostSerial::print(const char *s)
+{
+  return write((const uint8_t *)s, strlen(s));
+}
+
+size_t HostSerial::print(long n, int base)
+{
+  char buf[34];
+  return print(ltoa(n, buf, base));
+}
+
+size_t HostSerial::print(unsigned long n, int base)
+{
+  char buf[34];
+  return print(ultoa(n, buf, base));
+}
+
+void HostSerial::inject(const uint8_t *data, size_t len, uint64_t delay)
+{
+  uint64_t at = halNow() + delay;
+
+  if (__rxLast > at)
+    at = __rxLast;
+  for (size_t i = 0; i < len; i++)
+  {
+    at += byteTime();
+    Pending p = {at, data[i]};
+    __rx.push_back(p);
+  }
+  __rxLast = at;
+}
+
+size_t HostSerial::scheduled(void)
+{
+  return __rx.size();
+}
+
+uint64_t HostSerial::nextArrival(void)
+{
+  return __rx.empty() ? halNow() : __rx.front().at;
+}
+
+uint32_t HostSerial::byteTime(void)
+{
+  // start bit + 8 data bits + stop bit
+  return (uint32_t)((10000000ULL + __baud - 1) / __baud);
+}
+
+void HostSerial::onTransmit(HostTxCallback cb, void *ctx)
+{
+  __txCb = cb;
+  __txCtx = ctx;
+}
+
+void HostSerial::idle(uint32_t max)
+{
+  uint64_t until = halNow() + max;
+
+  for (HostSerial *p = __ports; p; p = p->__next)
+  {
+    if (!p->__rx.empty() && p->__rx.front().at < until)
+      until = p->__rx.front().at;
+  }
+  halAdvanceTo(until);
+}
@@ -0,0 +1,127 @@
+/**
+ * @file HostSerial.h
+ *
+ * Host version of the Arduino HardwareSerial. Bytes for the firmware are
+ * injected by the host and become available at the pace of the configured
+ * baudrate on the virtual clock; bytes written by the firmware are handed
+ * to a transmit callback, i.e. a device emulator.
+ *
+ * @author  Roy Wassili (waps61 @gmail.com)
+ * @date    2020/09/05
+ */
+#ifndef __HOSTSERIAL_H__
+#define __HOSTSERIAL_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <deque>
+#include "WString.h"
+
+#define DEC 10
+#define HEX 16
+
+/**
+ * Called for every byte the firmware writes; at is the virtual time in
+ * microseconds at which the byte has been transmitted completely.
+ */
+typedef void (*HostTxCallback)(uint8_t c, uint64_t at, void *ctx);
+
+class HostSerial
+{
+public: /* firmware side, as HardwareSerial */
+  HostSerial(void);
+
+  void begin(unsigned long baud);
+  void end(void);
+  int available(void);
+  int read(void);
+  int peek(void);
+  void flush(void);
+  void setTimeout(unsigned long timeout);
+  size_t readBytes(char *buffer, size_t length);
+  size_t readBytes(uint8_t *buffer, size_t length)
+  {
+    return readBytes((char *)buffer, length);
+  }
+
+  size_t write(uint8_t c);
+  size_t write(const uint8_t *buffer, size_t size);
+  size_t print(const char *s);
+  size_t print(const String &s) { return print(s.c_str()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(long n, int base = DEC);
+  size_t print(unsigned long n, int base = DEC);
+  size_t print(int n, int base = DEC) { return print((long)n, base); }
+  size_t print(unsigned int n, int base = DEC) { return print((unsigned long)n, base); }
+  size_t println(void) { return print("\r\n"); }
+  template <typename T>
+  size_t println(T v)
+  {
+    size_t n = print(v);
+    return n + println();
+  }
+  operator bool(void) { return true; }
+
+public: /* host side */
+  /**
+   * Schedules bytes to arrive after the ones already scheduled, spaced at
+   * 10 bit times of the current baudrate.
+   */
+  void inject(const uint8_t *data, size_t len, uint64_t delay = 0);
+
+  /**
+   * @return the nr of injected bytes not yet read, whether due or not.
+   */
+  size_t scheduled(void);
+
+  /**
+   * @return the virtual time at which the next injected byte is due; only
+   * valid when scheduled() > 0.
+   */
+  uint64_t nextArrival(void);
+
+  /**
+   * @return the virtual time at which the last written byte has left.
+   */
+  uint64_t txDoneAt(void) { return __txDoneAt; }
+
+  /**
+   * @return the time in microseconds to transfer 1 byte at the current
+   * baudrate.
+   */
+  uint32_t byteTime(void);
+
+  unsigned long baud(void) { return __baud; }
+
+  void onTransmit(HostTxCallback cb, void *ctx);
+
+  /**
+   * Advances the virtual clock by at most max microseconds, but not past the
+   * next byte due on any serial port.
+   */
+  static void idle(uint32_t max);
+
+private:
+  struct Pending
+  {
+    uint64_t at;
+    uint8_t c;
+  };
+  std::deque<Pending> __rx;
+  uint64_t __rxLast;
+  uint64_t __txDoneAt;
+  unsigned long __baud;
+  unsigned long __timeout;
+  HostTxCallback __txCb;
+  void *__txCtx;
+  HostSerial *__next; /* all ports, for idle() */
+  static HostSerial *__ports;
+};
+
+/**
+ * Serial is the Nextion link, Serial1 the NMEA input line.
+ */
+extern HostSerial Serial;
+extern HostSerial Serial1;
+
+#endif /* #ifndef __HOSTSERIAL_H__ */
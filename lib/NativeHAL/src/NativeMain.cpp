@@ -0,0 +1,158 @@
+/**
+ * @file NativeMain.cpp
+ *
+ * Host entry point: runs the firmware's setup() and loop() against a
+ * Nextion emulator on Serial and a byte stream injected on Serial1.
+ *
+ * Usage: program [--nmea <file>] [--nmea-baud <bd>] [--set <name>=<value>]
+ *                [--hmi-delay <us>] [--hmi-baud <bd>] [--link-limit <bd>]
+ *                [--relay <file>] [--trace]
+ *
+ * The NMEA file is fed at line rate once setup() has finished and the run
+ * ends when all of it has been read. Without --set the panel reports
+ * status.pic=4, the "selftest ok" picture the winddisplay HMI shows.
+ * Without --hmi-baud the panel starts at 38400 Bd, the rate the HMI is
+ * configured for. With --relay the bytes the firmware sends on the NMEA
+ * line, i.e. the relayed sentences, are written to a file.
+ *
+ * main() is weak so a benchmark or other host tool can bring its own.
+ *
+ * @author  Roy Wassili (waps61 @gmail.com)
+ * @date    2020/09/05
+ */
+#include "Arduino.h"
+#include "NexEmulator.h"
+#include <vector>
+
+/* the loop runs at least every LOOP_PERIOD us of virtual time when idle */
+#define LOOP_PERIOD 1000
+
+/* loops to run after the input has been consumed, to drain all queues */
+#define DRAIN_LOOPS 200
+
+/**
+ * Reads a complete file into data; "-" is stdin.
+ *
+ * @retval true - the file was read.
+ */
+bool halReadFile(const char *path, std::vector<uint8_t> &data)
+{
+  FILE *fp = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+  uint8_t buf[4096];
+  size_t n;
+
+  if (!fp)
+    return false;
+  while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+    data.insert(data.end(), buf, buf + n);
+  if (fp != stdin)
+    fclose(fp);
+  return true;
+}
+
+/**
+ * Transmit callback of Serial1 for --relay.
+ */
+static void relayByte(uint8_t c, uint64_t, void *ctx)
+{
+  fputc(c, (FILE *)ctx);
+}
+
+__attribute__((weak)) int main(int argc, char **argv)
+{
+  NexEmulator hmi(Serial);
+  std::vector<uint8_t> nmea;
+  unsigned long nmeaBaud = 0;
+  bool preset = false;
+  FILE *relay = NULL;
+
+  hmi.setBaud(38400);
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--nmea") == 0 && i + 1 < argc)
+    {
+      if (!halReadFile(argv[++i], nmea))
+      {
+        fprintf(stderr, "cannot read %s\n", argv[i]);
+        return 1;
+      }
+    }
+    else if (strcmp(argv[i], "--nmea-baud") == 0 && i + 1 < argc)
+    {
+      nmeaBaud = strtoul(argv[++i], NULL, 10);
+    }
+    else if (strcmp(argv[i], "--set") == 0 && i + 1 < argc)
+    {
+      const char *eq = strchr(argv[++i], '=');
+      if (eq)
+        hmi.set(std::string(argv[i], eq - argv[i]), strtoul(eq + 1, NULL, 10));
+      preset = true;
+    }
+    else if (strcmp(argv[i], "--hmi-delay") == 0 && i + 1 < argc)
+    {
+      hmi.setResponseDelay(strtoul(argv[++i], NULL, 10));
+    }
+    else if (strcmp(argv[i], "--hmi-baud") == 0 && i + 1 < argc)
+    {
+      hmi.setBaud(strtoul(argv[++i], NULL, 10));
+    }
+    else if (strcmp(argv[i], "--link-limit") == 0 && i + 1 < argc)
+    {
+      hmi.setLinkLimit(strtoul(argv[++i], NULL, 10));
+    }
+    else if (strcmp(argv[i], "--relay") == 0 && i + 1 < argc)
+    {
+      relay = fopen(argv[++i], "wb");
+      if (!relay)
+      {
+        fprintf(stderr, "cannot write %s\n", argv[i]);
+        return 1;
+      }
+      Serial1.onTransmit(relayByte, relay);
+    }
+    else if (strcmp(argv[i], "--trace") == 0)
+    {
+      hmi.setTrace(true);
+    }
+    else
+    {
+      fprintf(stderr, "usage: %s [--nmea <file>] [--nmea-baud <bd>] "
+                      "[--set <name>=<value>] [--hmi-delay <us>] [--hmi-baud <bd>] "
+                      "[--link-limit <bd>] [--relay <file>] [--trace]\n",
+              argv[0]);
+      return 1;
+    }
+  }
+  if (!preset)
+    hmi.set("status.pic", 4);
+
+  hmi.powerOn();
+  setup();
+  if (nmeaBaud)
+    Serial1.begin(nmeaBaud); // overrule the firmware, i.e. to stress test
+  if (!nmea.empty())
+    Serial1.inject(&nmea[0], nmea.size());
+
+  for (int drain = 0; drain < DRAIN_LOOPS;)
+  {
+    loop();
+    HostSerial::idle(LOOP_PERIOD);
+    if (Serial1.scheduled() == 0)
+      drain++;
+  }
+
+  fprintf(stderr, "%.3f s virtual time, %u NMEA bytes, %u Nextion commands\n",
+          halNow() / 1e6, (unsigned)nmea.size(), hmi.commands());
+  fprintf(stderr, "panel at %lu Bd, %u bytes lost to baudrate mismatches\n",
+          hmi.baud(), hmi.garbled());
+  for (std::map<std::string, uint32_t>::const_iterator it = hmi.verbs().begin();
+       it != hmi.verbs().end(); ++it)
+    fprintf(stderr, "  %-12s %u\n", it->first.empty() ? "(empty)" : it->first.c_str(), it->second);
+  if (relay)
+  {
+    fprintf(stderr, "%ld bytes relayed\n", ftell(relay));
+    fclose(relay);
+  }
+  return 0;
+}
@@ -0,0 +1,207 @@
+/**
+ * @file NexEmulator.cpp
+ *
+ * The implementation of class NexEmulator.
+ *
+ * @author  Roy Wassili (waps61 @gmail.com)
+ * @date    2020/09/05
+ */
+#include "Arduino.h"
+#include "NexEmulator.h"
+
+#define NEX_RET_INVALID_CMD (0x00)
+#define NEX_RET_CMD_FINISHED (0x01)
+#define NEX_RET_CURRENT_PAGE_ID_HEAD (0x66)
+#define NEX_RET_STRING_HEAD (0x70)
+#define NEX_RET_NUMBER_HEAD (0x71)
+#define NEX_RET_INVALID_BAUD (0x11)
+#define NEX_RET_INVALID_VARIABLE (0x1A)
+#define NEX_RET_EVENT_LAUNCHED (0x88)
+
+NexEmulator::NexEmulator(HostSerial &port)
+    : __port(port)
+{
+  __ffs = 0;
+  __bkcmd = 2; // panel default
+  __page = 0;
+  __baud = 9600; // factory default
+  __linkLimit = 0;
+  __garbled = 0;
+  __delay = 0;
+  __trace = false;
+  __commands = 0;
+  __bytes = 0;
+  port.onTransmit(receive, this);
+}
+
+void NexEmulator::powerOn(void)
+{
+  static const uint8_t r[10] = {0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF,
+                                   NEX_RET_EVENT_LAUNCHED, 0xFF, 0xFF, 0xFF};
+
+  reply(r, sizeof(r), halNow());
+}
+
+void NexEmulator::set(const std::string &name, uint32_t value)
+{
+  __values[name] = value;
+}
+
+uint32_t NexEmulator::value(const std::string &name)
+{
+  std::map<std::string, uint32_t>::iterator it = __values.find(name);
+  return it == __values.end() ? 0 : it->second;
+}
+
+void NexEmulator::receive(uint8_t c, uint64_t at, void *ctx)
+{
+  NexEmulator *self = (NexEmulator *)ctx;
+
+  self->__bytes++;
+  if (!self->inSync())
+  {
+    // a framing error at best; the command it belongs to is lost
+    self->__garbled++;
+    self->__cmd.clear();
+    self->__ffs = 0;
+    return;
+  }
+  if (c == 0xFF)
+  {
+    if (++self->__ffs == 3)
+    {
+      std::string cmd = self->__cmd;
+      self->__cmd.clear();
+      self->__ffs = 0;
+      self->execute(cmd, at);
+    }
+    return;
+  }
+  while (self->__ffs > 0) // a lone 0xFF is part of the command
+  {
+    self->__cmd += (char)0xFF;
+    self->__ffs--;
+  }
+  self->__cmd += (char)c;
+}
+
+void NexEmulator::execute(const std::string &cmd, uint64_t at)
+{
+  size_t eq = cmd.find('=');
+  size_t sp = cmd.find(' ');
+  std::string verb = cmd.substr(0, eq < sp ? eq : sp);
+
+  __commands++;
+  __verbs[verb]++;
+  if (__trace)
+    printf("%10.3f ms  %s\n", at / 1000.0, cmd.c_str());
+
+  at += __delay;
+  if (cmd.empty())
+  {
+    error(NEX_RET_INVALID_CMD, at);
+  }
+  else if (verb == "bkcmd" && eq != std::string::npos)
+  {
+    __bkcmd = (uint8_t)atoi(cmd.c_str() + eq + 1);
+    success(at);
+  }
+  else if (verb == "baud" && eq != std::string::npos)
+  {
+    static const unsigned long rates[] = {2400, 4800, 9600, 19200, 31250, 38400, 57600,
+                                          115200, 230400, 250000, 256000, 512000, 921600};
+    unsigned long baud = strtoul(cmd.c_str() + eq + 1, NULL, 10);
+    size_t i = 0;
+
+    while (i < sizeof(rates) / sizeof(rates[0]) && rates[i] != baud)
+      i++;
+    if (i == sizeof(rates) / sizeof(rates[0]))
+    {
+      error(NEX_RET_INVALID_BAUD, at);
+    }
+    else
+    {
+      // the panel switches at once, so even its reply uses the new rate
+      __baud = baud;
+      success(at);
+    }
+  }
+  else if (verb == "page")
+  {
+    __page = (uint8_t)atoi(cmd.c_str() + sp + 1);
+    success(at);
+  }
+  else if (verb == "get")
+  {
+    std::string name = cmd.substr(sp + 1);
+    if (__texts.count(name))
+    {
+      std::string r(1, (char)NEX_RET_STRING_HEAD);
+      r += __texts[name];
+      r += "\xFF\xFF\xFF";
+      reply((const uint8_t *)r.data(), r.size(), at);
+    }
+    else if (__values.count(name))
+    {
+      uint32_t v = __values[name];
+      uint8_t r[8] = {NEX_RET_NUMBER_HEAD, (uint8_t)v, (uint8_t)(v >> 8),
+                      (uint8_t)(v >> 16), (uint8_t)(v >> 24), 0xFF, 0xFF, 0xFF};
+      reply(r, sizeof(r), at);
+    }
+    else
+    {
+      error(NEX_RET_INVALID_VARIABLE, at);
+    }
+  }
+  else if (verb == "sendme")
+  {
+    uint8_t r[5] = {NEX_RET_CURRENT_PAGE_ID_HEAD, __page, 0xFF, 0xFF, 0xFF};
+    reply(r, sizeof(r), at);
+  }
+  else if (eq != std::string::npos)
+  {
+    std::string name = cmd.substr(0, eq);
+    std::string val = cmd.substr(eq + 1);
+    if (!val.empty() && val[0] == '"')
+      __texts[name] = val.substr(1, val.size() > 1 ? val.size() - 2 : 0);
+    else
+      __values[name] = (uint32_t)strtol(val.c_str(), NULL, 10);
+    success(at);
+  }
+  else
+  {
+    // code_c, ref_stop, ref_star, add and the like need no emulation
+    success(at);
+  }
+}
+
+bool NexEmulator::inSync(void)
+{
+  return __port.baud() == __baud && (__linkLimit == 0 || __baud <= __linkLimit);
+}
+
+void NexEmulator::reply(const uint8_t *data, size_t len, uint64_t at)
+{
+  if (!inSync())
+  {
+    __garbled += len;
+    return;
+  }
+  __port.inject(data, len, at > halNow() ? at - halNow() : 0);
+}
+
+void NexEmulator::success(uint64_t at)
+{
+  static const uint8_t r[4] = {NEX_RET_CMD_FINISHED, 0xFF, 0xFF, 0xFF};
+
+  if (__bkcmd == 1 || __bkcmd == 3)
+    reply(r, sizeof(r), at);
+}
+
+void NexEmulator::error(uint8_t code, uint64_t at)
+{
+  uint8_t r[4] = {code, 0xFF, 0xFF, 0xFF};
+
+  if (__bkcmd == 2 || __bkcmd == 3)
+    reply(r, sizeof(r), at);
+}
@@ -0,0 +1,117 @@
+/**
+ * @file NexEmulator.h
+ *
+ * Minimal emulation of a Nextion panel on the host side of a HostSerial.
+ *
+ * Commands are collected up to the 0xFF 0xFF 0xFF terminator and answered
+ * as a panel would for the commands the firmware uses: assignments, get,
+ * page, bkcmd, baud, code_c, ref_stop/ref_star and sendme. Replies honour
+ * the bkcmd response mode and are sent back at the baudrate of the port.
+ *
+ * The panel has a baudrate of its own. While the port runs at another
+ * rate, or either exceeds what the link sustains, all bytes in both
+ * directions are lost as a real panel would see framing errors.
+ *
+ * @author  Roy Wassili (waps61 @gmail.com)
+ * @date    2020/09/05
+ */
+#ifndef __NEXEMULATOR_H__
+#define __NEXEMULATOR_H__
+
+#include <map>
+#include <string>
+#include "HostSerial.h"
+
+class NexEmulator
+{
+public:
+  explicit NexEmulator(HostSerial &port);
+
+  /**
+   * Presets a numeric attribute, i.e. set("status.pic", 4).
+   */
+  void set(const std::string &name, uint32_t value);
+
+  /**
+   * @return the value of a numeric attribute, 0 when never assigned.
+   */
+  uint32_t value(const std::string &name);
+
+  /**
+   * Sends what a panel sends after power on: the startup frame
+   * 0x00 0x00 0x00 and the ready event 0x88.
+   */
+  void powerOn(void);
+
+  /**
+   * Sets the baudrate of the panel, 9600 Bd by default.
+   */
+  void setBaud(unsigned long baud) { __baud = baud; }
+  unsigned long baud(void) { return __baud; }
+
+  /**
+   * Highest baudrate the link sustains, i.e. because of a long cable;
+   * 0 for no limit.
+   */
+  void setLinkLimit(unsigned long baud) { __linkLimit = baud; }
+
+  /**
+   * @return the nr of bytes lost to a baudrate mismatch.
+   */
+  uint32_t garbled(void) { return __garbled; }
+
+  /**
+   * Time in microseconds the panel needs to execute a command before it
+   * replies.
+   */
+  void setResponseDelay(uint32_t us) { __delay = us; }
+
+  /**
+   * Prints every command received on stdout.
+   */
+  void setTrace(bool trace) { __trace = trace; }
+
+  /**
+   * @return the nr of commands received in total.
+   */
+  uint32_t commands(void) { return __commands; }
+
+  /**
+   * @return the nr of commands received per verb; the verb is the text
+   * before the 1st space or '=' (i.e. "sys2", "get", "page").
+   */
+  const std::map<std::string, uint32_t> &verbs(void) { return __verbs; }
+
+  /**
+   * @return the nr of bytes received.
+   */
+  uint32_t bytes(void) { return __bytes; }
+
+  uint8_t page(void) { return __page; }
+
+private:
+  static void receive(uint8_t c, uint64_t at, void *ctx);
+  void execute(const std::string &cmd, uint64_t at);
+  bool inSync(void);
+  void reply(const uint8_t *data, size_t len, uint64_t at);
+  void success(uint64_t at);
+  void error(uint8_t code, uint64_t at);
+
+  HostSerial &__port;
+  std::string __cmd;
+  uint8_t __ffs;
+  uint8_t __bkcmd;
+  uint8_t __page;
+  unsigned long __baud;
+  unsigned long __linkLimit;
+  uint32_t __garbled;
+  uint32_t __delay;
+  bool __trace;
+  uint32_t __commands;
+  uint32_t __bytes;
+  std::map<std::string, uint32_t> __values;
+  std::map<std::string, std::string> __texts;
+  std::map<std::string, uint32_t> __verbs;
+};
+
+#endif /* #ifndef __NEXEMULATOR_H__ */
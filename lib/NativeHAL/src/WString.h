@@ -0,0 +1,109 @@
+/**
+ * @file WString.h
+ *
+ * Host version of the Arduino String class; only the members used by the
+ * firmware and by the legacy references of the replay bench are provided.
+ *
+ * The buffer is managed like the Arduino core does: it is grown with
+ * realloc() to the exact length needed, so every concatenation that makes
+ * the string longer costs a heap allocation. allocations() counts them,
+ * which lets the host measure what a piece of code costs on the heap.
+ *
+ * @author  Roy Wassili (waps61 @gmail.com)
+ * @date    2020/09/05
+ */
+#ifndef __WSTRING_H__
+#define __WSTRING_H__
+
+#include <stdlib.h>
+#include <string.h>
+
+class String
+{
+public:
+  String(void) { init(); }
+  String(const char *s)
+  {
+    init();
+    *this += s ? s : "";
+  }
+  String(const String &s)
+  {
+    init();
+    *this += s;
+  }
+  ~String() { free(__buf); }
+
+  String &operator=(const String &s)
+  {
+    if (this != &s)
+    {
+      __len = 0;
+      if (__buf)
+        __buf[0] = '\0';
+      *this += s;
+    }
+    return *this;
+  }
+  String &operator+=(const char *s) { return concat(s, strlen(s)); }
+  String &operator+=(const String &s) { return concat(s.c_str(), s.__len); }
+  String &operator+=(char c) { return concat(&c, 1); }
+  const char *c_str(void) const { return __buf ? __buf : ""; }
+  unsigned int length(void) const { return __len; }
+  char operator[](unsigned int i) const { return i < __len ? __buf[i] : '\0'; }
+
+  /**
+   * @return the index of the first c or s at or after from, -1 if none.
+   */
+  int indexOf(char c, unsigned int from = 0) const
+  {
+    const char *p = from < __len ? strchr(__buf + from, c) : NULL;
+    return p ? p - __buf : -1;
+  }
+  int indexOf(const String &s, unsigned int from = 0) const
+  {
+    const char *p = from < __len ? strstr(__buf + from, s.c_str()) : NULL;
+    return p ? p - __buf : -1;
+  }
+
+  /**
+   * @return the nr of heap (re)allocations done by all strings so far.
+   */
+  static unsigned long allocations(void) { return counter(); }
+
+private:
+  void init(void)
+  {
+    __buf = NULL;
+    __len = 0;
+    __capacity = 0;
+  }
+  String &concat(const char *s, unsigned int n)
+  {
+    if (__len + n > __capacity || !__buf)
+    {
+      char *buf = (char *)realloc(__buf, __len + n + 1);
+
+      if (!buf)
+        return *this;
+      __buf = buf;
+      __capacity = __len + n;
+      counter()++;
+    }
+    memcpy(__buf + __len, s, n);
+    __len += n;
+    __buf[__len] = '\0';
+    return *this;
+  }
+  static unsigned long &counter(void)
+  {
+    static unsigned long n = 0;
+    return n;
+  }
+
+  char *__buf;
+  unsigned int __len;
+  unsigned int __capacity;
+};
+
+#endif /* #ifndef __WSTRING_H__ */
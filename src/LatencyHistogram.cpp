@@ -0,0 +1,42 @@
+/**
+ * @file LatencyHistogram.cpp
+ *
+ * The implementation of the latency histogram.
+ *
+ * @author  Roy Wassili (waps61 @gmail.com)
+ * @date    2020/09/15
+ */
+#include "LatencyHistogram.h"
+#include "NexConfig.h"
+
+void latencyRecord(LatencyHistogram *h, uint32_t us)
+{
+  uint8_t i = 0;
+
+  for (uint32_t v = us >> LATENCY_SHIFT; v > 0 && i < LATENCY_BUCKETS - 1; v >>= 1)
+    i++;
+  if (h->count[i] < 0xFFFF)
+    h->count[i]++;
+  if (us > h->max)
+    h->max = us;
+}
+
+uint32_t latencyBucketStart(uint8_t i)
+{
+  return i == 0 ? 0 : 1UL << (LATENCY_SHIFT + i - 1);
+}
+
+void latencyDump(const LatencyHistogram *h)
+{
+  dbSerialPrintln("latency us: count");
+  for (uint8_t i = 0; i < LATENCY_BUCKETS; i++)
+  {
+    if (h->count[i] == 0)
+      continue;
+    dbSerialPrint(latencyBucketStart(i));
+    dbSerialPrint(": ");
+    dbSerialPrintln(h->count[i]);
+  }
+  dbSerialPrint("max: ");
+  dbSerialPrintln(h->max);
+}
@@ -0,0 +1,89 @@
+/**
+ * @file LoopStats.cpp
+ *
+ * The implementation of the loop timing.
+ *
+ * @author  Roy Wassili (waps61 @gmail.com)
+ * @date    2020/09/14
+ */
+#include "LoopStats.h"
+
+static LoopStageStats stages[LOOP_STAGES];
+static uint32_t loopStart;
+static bool started = false;
+static uint8_t rxHighWater = 0;
+
+static void record(uint8_t stage, uint32_t us)
+{
+  LoopStageStats *s = &stages[stage];
+  uint16_t t = us > 0xFFFF ? 0xFFFF : us;
+
+  if (s->count == 0 || t < s->min)
+    s->min = t;
+  if (t > s->max)
+    s->max = t;
+  s->sum += t;
+  s->count++;
+}
+
+uint32_t loopStatsBegin(uint8_t rxFill)
+{
+  uint32_t now = micros();
+
+  if (started)
+    record(STAGE_LOOP, now - loopStart);
+  started = true;
+  loopStart = now;
+  if (rxFill > rxHighWater)
+    rxHighWater = rxFill;
+  return now;
+}
+
+uint32_t loopStatsStage(uint8_t stage, uint32_t start)
+{
+  uint32_t now = micros();
+
+  record(stage, now - start);
+  return now;
+}
+
+const LoopStageStats *loopStats(uint8_t stage)
+{
+  return &stages[stage];
+}
+
+void loopStatsReset(uint8_t stage)
+{
+  stages[stage].min = 0;
+  stages[stage].max = 0;
+  stages[stage].sum = 0;
+  stages[stage].count = 0;
+}
+
+uint8_t loopStatsRxHighWater(void)
+{
+  return rxHighWater;
+}
+
+uint8_t loopStatsSentence(char *buf, uint8_t size)
+{
+  static const char names[LOOP_STAGES] = {'R', 'P', 'D', 'N', 'L'};
+  static uint8_t next = 0;
+  const LoopStageStats *s = &stages[next];
+  uint8_t len;
+
+  if (size < 26) // "$PYAZT,X" + 3 * ",65535"
+    return 0;
+  strcpy(buf, "$PYAZT,");
+  len = 7;
+  buf[len++] = names[next];
+  buf[len++] = ',';
+  len += strlen(utoa(s->min, buf + len, 10));
+  buf[len++] = ',';
+  len += strlen(ultoa(s->count ? s->sum / s->count : 0, buf + len, 10));
+  buf[len++] = ',';
+  len += strlen(utoa(s->max, buf + len, 10));
+  loopStatsReset(next);
+  next = (next + 1) % LOOP_STAGES;
+  return len;
+}
@@ -0,0 +1,193 @@
+/**
+ * @file NMEAParser.cpp
+ *
+ * The implementation of the NMEA0183 sentence tokenizer.
+ *
+ * @author  Roy Wassili (waps61 @gmail.com)
+ * @date    2020/08/31
+ */
+#include "NMEAParser.h"
+
+uint8_t nmeaTokenize(const char *buf, NMEASentence *s)
+{
+  uint8_t i = 0;
+  uint8_t start;
+  char c;
+
+  s->buf = buf;
+  s->count = 0;
+
+  if (buf[0] == '$' || buf[0] == '!')
+    i = 1;
+  start = i;
+
+  // one pass; every ',' closes the current field and opens the next one
+  for (;;)
+  {
+    c = buf[i];
+    if (c == ',' || c == '*' || c == '\r' || c == '\n' || c == '\0')
+    {
+      if (s->count < NMEA_MAX_FIELDS)
+      {
+        s->field[s->count].start = start;
+        s->field[s->count].len = i - start;
+        s->count++;
+      }
+      if (c != ',')
+        break;
+      start = i + 1;
+    }
+    i++;
+    if (i == 0xFF) // never run past what an 8-bit offset can address
+      break;
+  }
+  return s->count;
+}
+
+uint8_t nmeaCopyField(const NMEASentence *s, uint8_t i, char *dst, uint8_t size)
+{
+  uint8_t len = nmeaFieldLen(s, i);
+
+  if (size == 0)
+    return 0;
+  if (len > size - 1)
+    len = size - 1;
+  if (len > 0)
+    memcpy(dst, s->buf + s->field[i].start, len);
+  dst[len] = '\0';
+  return len;
+}
+
+bool nmeaParseFixed(const char *p, uint8_t len, uint8_t decimals, int32_t *value)
+{
+  const char *end = p + len;
+  bool negative = false;
+  bool point = false;
+  bool any = false;       // at least one digit seen
+  uint8_t digits = 0;     // nr of digits taken into the result
+  uint8_t fraction = 0;   // nr of decimals taken into the result
+  int8_t roundDigit = -1; // 1st surplus decimal, decides on rounding
+  uint32_t result = 0;
+  char c;
+
+  if (p < end && (*p == '-' || *p == '+'))
+  {
+    negative = (*p == '-');
+    p++;
+  }
+  for (; p < end; p++)
+  {
+    c = *p;
+    if (c == '.' && !point)
+    {
+      point = true;
+    }
+    else if (c >= '0' && c <= '9')
+    {
+      any = true;
+      if (point && fraction == decimals)
+      {
+        if (roundDigit < 0)
+          roundDigit = c - '0';
+        continue;
+      }
+      if (digits >= 9)
+        return false;
+      result = result * 10 + (c - '0');
+      digits++;
+      if (point)
+        fraction++;
+    }
+    else
+    {
+      return false;
+    }
+  }
+  if (!any)
+    return false;
+  // the padding counts against the 9 digits as well
+  for (; fraction < decimals; fraction++)
+  {
+    if (digits++ >= 9)
+      return false;
+    result *= 10;
+  }
+  if (roundDigit >= 5)
+    result++;
+  *value = negative ? -(int32_t)result : (int32_t)result;
+  return true;
+}
+
+uint32_t nmeaSentenceId(const NMEASentence *s)
+{
+  const char *tag = nmeaField(s, 0);
+
+  // tag is <talker id><sentence id>, i.e. IIVWR
+  if (nmeaFieldLen(s, 0) != 5 || tag[0] == 'P')
+    return 0;
+  return NMEA_SENTENCE_ID(tag[2], tag[3], tag[4]);
+}
+
+uint32_t nmeaTagId(const char *sentence)
+{
+  for (uint8_t i = 1; i < 6; i++)
+  {
+    if (sentence[i] == ',' || sentence[i] == '\0')
+      return 0;
+  }
+  if (sentence[6] != ',' || sentence[1] == 'P')
+    return 0;
+  return NMEA_SENTENCE_ID(sentence[3], sentence[4], sentence[5]);
+}
+
+int8_t nmeaHexValue(char c)
+{
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  return -1;
+}
+
+uint8_t nmeaAppendChecksum(char *buf, uint8_t len, uint8_t size)
+{
+  static const char hex[] = "0123456789ABCDEF";
+  uint8_t checksum = 0;
+
+  if (len < 1 || (uint16_t)len + 6 > size)
+    return 0;
+  for (uint8_t i = 1; i < len; i++)
+    checksum ^= buf[i];
+  buf[len++] = '*';
+  buf[len++] = hex[checksum >> 4];
+  buf[len++] = hex[checksum & 0x0F];
+  buf[len++] = '\r';
+  buf[len++] = '\n';
+  buf[len] = '\0';
+  return len;
+}
+
+int8_t nmeaLookup(uint32_t id, const NMEADispatch *table, uint8_t count)
+{
+  for (uint8_t i = 0; i < count; i++)
+  {
+    if (table[i].id == id)
+      return i;
+  }
+  return -1;
+}
+
+bool nmeaDispatch(const NMEASentence *s, const NMEADispatch *table, uint8_t count)
+{
+  uint32_t id = nmeaSentenceId(s);
+  int8_t i;
+
+  if (id == 0)
+    return false;
+  i = nmeaLookup(id, table, count);
+  if (i < 0)
+    return false;
+  return table[i].decode(s);
+}
@@ -0,0 +1,118 @@
+/**
+ * @file NMEAQueue.cpp
+ *
+ * The implementation of class NMEAQueue.
+ *
+ * @author  Roy Wassili (waps61 @gmail.com)
+ * @date    2020/08/31
+ */
+#include "NMEAQueue.h"
+
+#if NMEA_QUEUE_SLOTS > 8
+#error "NMEA_QUEUE_SLOTS must be at most 8"
+#endif
+
+NMEAQueue::NMEAQueue(void)
+{
+  __receive = 0;
+  __held = 0;
+  __pending = 0;
+  __highWater = 0;
+  __dropped = 0;
+}
+
+char *NMEAQueue::receiveSlot(void)
+{
+  return __data[__receive];
+}
+
+bool NMEAQueue::commit(uint8_t len, uint32_t stamp)
+{
+  uint8_t used = __held + __pending;
+  uint8_t busy = 1 << __receive;
+
+  // the receive slot itself can never be pending or held
+  if (used >= NMEA_QUEUE_SLOTS - 1)
+  {
+    __dropped++;
+    return false;
+  }
+  __len[__receive] = len;
+  __stamp[__receive] = stamp;
+  __order[used] = __receive;
+  __pending++;
+  if (__pending > __highWater)
+    __highWater = __pending;
+
+  // any slot that is neither pending nor held will do
+  for (uint8_t i = 0; i < used; i++)
+    busy |= 1 << __order[i];
+  for (__receive = 0; busy & (1 << __receive); __receive++)
+    ;
+  return true;
+}
+
+const char *NMEAQueue::front(void)
+{
+  return __pending > 0 ? __data[__order[__held]] : NULL;
+}
+
+uint8_t NMEAQueue::frontLength(void)
+{
+  return __pending > 0 ? __len[__order[__held]] : 0;
+}
+
+uint32_t NMEAQueue::frontStamp(void)
+{
+  return __pending > 0 ? __stamp[__order[__held]] : 0;
+}
+
+void NMEAQueue::pop(void)
+{
+  if (__pending > 0)
+  {
+    __pending--;
+    for (uint8_t i = __held; i < __held + __pending; i++)
+      __order[i] = __order[i + 1];
+  }
+}
+
+void NMEAQueue::hold(void)
+{
+  // the oldest pending slot is next to the newest held one
+  if (__pending > 0)
+  {
+    __pending--;
+    __held++;
+  }
+}
+
+void NMEAQueue::release(void)
+{
+  if (__held > 0)
+  {
+    __held--;
+    for (uint8_t i = 0; i < __held + __pending; i++)
+      __order[i] = __order[i + 1];
+  }
+}
+
+uint8_t NMEAQueue::held(void)
+{
+  return __held;
+}
+
+uint8_t NMEAQueue::pending(void)
+{
+  return __pending;
+}
+
+uint8_t NMEAQueue::highWater(void)
+{
+  return __highWater;
+}
+
+uint16_t NMEAQueue::dropped(void)
+{
+  return __dropped;
+}
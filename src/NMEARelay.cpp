@@ -0,0 +1,291 @@
+/**
+ * @file NMEARelay.cpp
+ *
+ * The implementation of class NMEARelay.
+ *
+ * @author  Roy Wassili (waps61 @gmail.com)
+ * @date    2020/09/12
+ */
+#include "NMEARelay.h"
+
+#if (NMEA_TX_SPANS & (NMEA_TX_SPANS - 1)) != 0 || NMEA_TX_SPANS > 128
+#error "NMEA_TX_SPANS must be a power of 2 of at most 128"
+#endif
+
+#if defined(__AVR__) && NMEA_TX_PIN != 9
+#error "NMEA_TX_PIN must be pin 9, the output compare pin of Timer1"
+#endif
+
+#define TX_MASK (NMEA_TX_SPANS - 1)
+
+volatile NMEARelay::Span NMEARelay::__spans[NMEA_TX_SPANS];
+volatile uint8_t NMEARelay::__head = 0;
+volatile uint8_t NMEARelay::__tail = 0;
+volatile uint8_t NMEARelay::__released = 0;
+uint8_t NMEARelay::__reclaimed = 0;
+uint8_t NMEARelay::__heldSent = 0;
+uint16_t NMEARelay::__overruns = 0;
+
+#ifdef __AVR__
+/*
+ * State of the bit sender, only touched from the interrupt once running.
+ */
+static uint8_t clockSelect; /* Timer1 prescaler bits */
+static uint8_t txBit;       /* next bit to program: 0 = start, 1-8 = data, 9 = stop */
+static uint8_t txByte;
+static uint8_t txPos;       /* next byte in the span at __tail */
+
+/*
+ * Sets the level the pin takes at the next compare match; true is a
+ * mark (1).
+ */
+static inline void txLevel(bool mark)
+{
+#ifdef NMEA_TX_INVERTED
+  mark = !mark;
+#endif
+  TCCR1A = mark ? _BV(COM1A1) | _BV(COM1A0) : _BV(COM1A1);
+}
+
+void NMEARelay::begin(uint32_t baud)
+{
+  // prescalers of Timer1 in order of their clock select bits
+  static const uint16_t prescalers[] = {1, 8, 64, 256, 1024};
+  uint32_t ticks = 0;
+  uint8_t cs;
+
+  for (cs = 0; cs < sizeof(prescalers) / sizeof(prescalers[0]); cs++)
+  {
+    ticks = F_CPU / ((uint32_t)prescalers[cs] * baud);
+    if (ticks <= 65535)
+      break;
+  }
+  clockSelect = cs + 1;
+
+  uint8_t sreg = SREG;
+  cli();
+  TCCR1B = 0;
+  TIMSK1 = 0;
+  OCR1A = ticks - 1;
+  // the compare unit owns the pin from here on; force it to idle first
+  txLevel(true);
+  TCCR1C = _BV(FOC1A);
+  pinMode(NMEA_TX_PIN, OUTPUT);
+  txBit = 10;
+  SREG = sreg;
+}
+
+void NMEARelay::end(void)
+{
+  uint8_t sreg = SREG;
+  cli();
+  TCCR1B = 0;
+  TIMSK1 = 0;
+  drop();
+  txPos = 0;
+  SREG = sreg;
+}
+
+bool NMEARelay::send(const char *data, uint8_t len, bool held)
+{
+  uint8_t sreg = SREG;
+  cli();
+  if ((uint8_t)(__head - __tail) >= NMEA_TX_SPANS ||
+      (held && (uint8_t)(__heldSent - __reclaimed) >= NMEA_TX_HELD))
+  {
+    __overruns++;
+    SREG = sreg;
+    return false;
+  }
+  volatile Span *span = &__spans[__head & TX_MASK];
+  span->data = data;
+  span->len = len;
+  span->held = held;
+  __heldSent += held;
+  __head = __head + 1;
+  if (!(TIMSK1 & _BV(OCIE1A)))
+  {
+    // idle; the 1st interrupt comes a bit later and starts the 1st byte
+    txBit = 10;
+    txPos = 0;
+    TCNT1 = 0;
+    TIFR1 = _BV(OCF1A);
+    TIMSK1 = _BV(OCIE1A);
+    TCCR1B = _BV(WGM12) | clockSelect; // CTC, top is OCR1A
+  }
+  SREG = sreg;
+  return true;
+}
+
+/*
+ * Spans are retired by the interrupt, nothing to do.
+ */
+void NMEARelay::pump(void)
+{
+}
+
+#else /* host: the bytes go out on Serial1 of the native HAL */
+
+/*
+ * Virtual time at which each span has left the line.
+ */
+static uint64_t spanDone[NMEA_TX_SPANS];
+
+void NMEARelay::begin(uint32_t)
+{
+}
+
+void NMEARelay::end(void)
+{
+  drop();
+}
+
+bool NMEARelay::send(const char *data, uint8_t len, bool held)
+{
+  if ((uint8_t)(__head - __tail) >= NMEA_TX_SPANS ||
+      (held && (uint8_t)(__heldSent - __reclaimed) >= NMEA_TX_HELD))
+  {
+    __overruns++;
+    return false;
+  }
+  volatile Span *span = &__spans[__head & TX_MASK];
+  span->data = data;
+  span->len = len;
+  span->held = held;
+  __heldSent += held;
+  // the host serial paces the bytes on the virtual clock; the span stays
+  // in use until the last one has left, as it would on the board
+  Serial1.write((const uint8_t *)data, len);
+  spanDone[__head & TX_MASK] = Serial1.txDoneAt();
+  __head = __head + 1;
+  return true;
+}
+
+/*
+ * Retires the spans that have left the line by now, as the interrupt would
+ * have done in the meantime.
+ */
+void NMEARelay::pump(void)
+{
+  while (__tail != __head && spanDone[__tail & TX_MASK] <= halNow())
+  {
+    if (__spans[__tail & TX_MASK].held)
+      __released = __released + 1;
+    __tail = __tail + 1;
+  }
+}
+
+void NMEARelay::onBitTimer(void)
+{
+}
+
+#endif /* __AVR__ */
+
+void NMEARelay::drop(void)
+{
+  // the held ones are done with as well
+  for (; __tail != __head; __tail = __tail + 1)
+  {
+    if (__spans[__tail & TX_MASK].held)
+      __released = __released + 1;
+  }
+}
+
+bool NMEARelay::sending(const char *data)
+{
+  bool found = false;
+
+  pump();
+#ifdef __AVR__
+  uint8_t sreg = SREG;
+  cli();
+#endif
+  for (uint8_t i = __tail; i != __head; i++)
+  {
+    if (__spans[i & TX_MASK].data == data)
+      found = true;
+  }
+#ifdef __AVR__
+  SREG = sreg;
+#endif
+  return found;
+}
+
+uint8_t NMEARelay::reclaim(void)
+{
+  uint8_t n;
+
+  pump();
+  n = __released - __reclaimed; // single byte read, so atomic
+  __reclaimed += n;
+  return n;
+}
+
+uint16_t NMEARelay::overruns(void)
+{
+  return __overruns;
+}
+
+#ifdef __AVR__
+/*
+ * Hands out the next byte to send and retires the spans that are done.
+ *
+ * @return false when there is nothing left to send.
+ */
+bool NMEARelay::fetch(uint8_t *c)
+{
+  while (__tail != __head)
+  {
+    volatile Span *span = &__spans[__tail & TX_MASK];
+    bool more = txPos < span->len;
+
+    if (more)
+      *c = span->data[txPos++];
+    if (txPos >= span->len)
+    {
+      // the last byte is in txByte, so the span itself is free
+      if (span->held)
+        __released = __released + 1;
+      __tail = __tail + 1;
+      txPos = 0;
+    }
+    if (more)
+      return true;
+  }
+  return false;
+}
+
+/*
+ * Compare match: the bit programmed before is on the line now; program the
+ * next one. After the stop bit the next byte starts or the timer stops,
+ * leaving the line at mark.
+ */
+void NMEARelay::onBitTimer(void)
+{
+  if (txBit > 9)
+  {
+    if (!fetch(&txByte))
+    {
+      TCCR1B = 0;
+      TIMSK1 = 0;
+      return;
+    }
+    txBit = 0;
+  }
+  if (txBit == 0)
+    txLevel(false);
+  else if (txBit <= 8)
+  {
+    txLevel(txByte & 1); // LSB goes first
+    txByte >>= 1;
+  }
+  else
+    txLevel(true);
+  txBit++;
+}
+
+ISR(TIMER1_COMPA_vect)
+{
+  NMEARelay::onBitTimer();
+}
+#endif /* __AVR__ */
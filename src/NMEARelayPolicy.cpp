@@ -0,0 +1,139 @@
+/**
+ * @file NMEARelayPolicy.cpp
+ *
+ * The implementation of class NMEARelayPolicy.
+ *
+ * @author  Roy Wassili (waps61 @gmail.com)
+ * @date    2020/09/13
+ */
+#include "NMEARelayPolicy.h"
+#include "NMEAParser.h"
+
+NMEARelayPolicy::NMEARelayPolicy(NMEARelayRule *rules, uint8_t count)
+{
+  __rules = rules;
+  __count = count;
+  __forwarded = 0;
+  __shed = 0;
+  begin(4800, 100, 0);
+}
+
+void NMEARelayPolicy::begin(uint32_t baud, uint8_t budget, uint32_t now)
+{
+  // 10 bits per byte with the start and stop bit
+  __rate = baud / 10 * budget / 100;
+  __credit = NMEA_RELAY_BURST * 1000UL;
+  __refill = now;
+}
+
+/*
+ * @return the 1st relay rule for the tag after the start delimiter.
+ */
+NMEARelayRule *NMEARelayPolicy::match(const char *tag)
+{
+  for (uint8_t i = 0; i < __count; i++)
+  {
+    NMEARelayRule *rule = &__rules[i];
+    uint8_t c;
+
+    if (rule->inject != NULL)
+      continue;
+    for (c = 0; c < 5; c++)
+    {
+      if (rule->tag[c] != NMEA_RELAY_ANY && rule->tag[c] != tag[c + 1])
+        break;
+    }
+    if (c == 5)
+      return rule;
+  }
+  return NULL;
+}
+
+/*
+ * Takes len bytes off the budget when the bucket holds them.
+ */
+bool NMEARelayPolicy::spend(uint8_t len, uint32_t now)
+{
+  uint32_t dt = now - __refill;
+  uint32_t cost = len * 1000UL;
+
+  __refill = now;
+  __credit += (dt > 1000 ? 1000 : dt) * __rate;
+  if (__credit > NMEA_RELAY_BURST * 1000UL)
+    __credit = NMEA_RELAY_BURST * 1000UL;
+  if (__credit < cost)
+    return false;
+  __credit -= cost;
+  return true;
+}
+
+/*
+ * @return true when the rule lets a sentence through at this time.
+ */
+static bool due(const NMEARelayRule *rule, uint32_t now)
+{
+  return rule->interval == NMEA_RELAY_PASS ||
+         (rule->interval != NMEA_RELAY_DROP && now - rule->last >= rule->interval);
+}
+
+/*
+ * Moves the interval of a rule on; a steady cadence, so a talker at 2 Hz
+ * thinned to 1 Hz loses every other sentence and not 2 of 3 on jitter.
+ */
+static void next(NMEARelayRule *rule, uint32_t now)
+{
+  if (now - rule->last >= 2UL * rule->interval)
+    rule->last = now;
+  else
+    rule->last += rule->interval;
+}
+
+bool NMEARelayPolicy::wanted(const char *tag, uint32_t now)
+{
+  NMEARelayRule *rule = match(tag);
+
+  return rule != NULL && due(rule, now);
+}
+
+bool NMEARelayPolicy::admit(const char *sentence, uint8_t len, uint32_t now)
+{
+  NMEARelayRule *rule = match(sentence);
+
+  if (rule == NULL || !due(rule, now) || !spend(len, now))
+  {
+    if (rule != NULL)
+      rule->shed++;
+    __shed++;
+    return false;
+  }
+  next(rule, now);
+  rule->forwarded++;
+  __forwarded++;
+  return true;
+}
+
+uint8_t NMEARelayPolicy::inject(uint32_t now, char *buf, uint8_t size)
+{
+  for (uint8_t i = 0; i < __count; i++)
+  {
+    NMEARelayRule *rule = &__rules[i];
+    uint8_t len;
+
+    if (rule->inject == NULL || !due(rule, now))
+      continue;
+    len = nmeaAppendChecksum(buf, rule->inject(buf, size - 6), size);
+    if (len == 0)
+    {
+      // nothing to say this interval; the rules after it get their turn
+      next(rule, now);
+      continue;
+    }
+    if (!spend(len, now))
+      return 0; // try again on the next call
+    next(rule, now);
+    rule->forwarded++;
+    __forwarded++;
+    return len;
+  }
+  return 0;
+}
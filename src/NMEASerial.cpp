@@ -0,0 +1,262 @@
+/**
+ * @file NMEASerial.cpp
+ *
+ * The implementation of class NMEASerial.
+ *
+ * @author  Roy Wassili (waps61 @gmail.com)
+ * @date    2020/08/31
+ */
+#include "NMEASerial.h"
+
+#if (NMEA_RX_BUFFER_SIZE & (NMEA_RX_BUFFER_SIZE - 1)) != 0 || NMEA_RX_BUFFER_SIZE > 128
+#error "NMEA_RX_BUFFER_SIZE must be a power of 2 of at most 128"
+#endif
+
+#if defined(__AVR__) && (NMEA_RX_PIN < 8 || NMEA_RX_PIN > 13)
+#error "NMEA_RX_PIN must be one of the pins 8-13"
+#endif
+
+#define RX_MASK (NMEA_RX_BUFFER_SIZE - 1)
+
+volatile uint8_t NMEASerial::__buffer[NMEA_RX_BUFFER_SIZE];
+volatile uint8_t NMEASerial::__head = 0;
+volatile uint8_t NMEASerial::__tail = 0;
+volatile uint16_t NMEASerial::__overflows = 0;
+volatile uint16_t NMEASerial::__framingErrors = 0;
+
+#ifdef __AVR__
+/*
+ * State of the bit sampler, only touched from the interrupts.
+ */
+static uint8_t bitTicks;     /* timer ticks per bit */
+static uint8_t clockSelect;  /* Timer2 prescaler bits */
+static uint8_t bitState;     /* 0 = start bit, 1-8 = data bits, 9 = stop bit */
+static uint8_t rxByte;
+static volatile uint8_t *rxPort;
+static uint8_t rxMask;
+
+/*
+ * Reads the logical level of the input; true is a mark (1).
+ */
+static inline bool rxMark(void)
+{
+  bool level = (*rxPort & rxMask) != 0;
+#ifdef NMEA_RX_INVERTED
+  return !level;
+#else
+  return level;
+#endif
+}
+
+/*
+ * Stops the bit timer and waits for the next start bit.
+ */
+static inline void rxIdle(void)
+{
+  TCCR2B = 0;
+  bitState = 0;
+  PCIFR = _BV(PCIF0); // forget the edges seen during the byte
+  PCMSK0 |= _BV(NMEA_RX_PIN - 8);
+}
+
+void NMEASerial::begin(uint32_t baud)
+{
+  // prescalers of Timer2 in order of their clock select bits
+  static const uint16_t prescalers[] = {1, 8, 32, 64, 128, 256, 1024};
+  uint32_t ticks = 0;
+  uint8_t cs;
+
+  for (cs = 0; cs < sizeof(prescalers) / sizeof(prescalers[0]); cs++)
+  {
+    ticks = F_CPU / ((uint32_t)prescalers[cs] * baud);
+    if (ticks <= 255)
+      break;
+  }
+  bitTicks = (uint8_t)ticks;
+  clockSelect = cs + 1;
+  rxPort = portInputRegister(digitalPinToPort(NMEA_RX_PIN));
+  rxMask = digitalPinToBitMask(NMEA_RX_PIN);
+
+  uint8_t sreg = SREG;
+  cli();
+  TCCR2A = _BV(WGM21); // CTC, top is OCR2A
+  TCCR2B = 0;          // stopped until a start bit comes in
+  OCR2A = bitTicks - 1;
+  TIMSK2 = _BV(OCIE2A);
+  bitState = 0;
+  PCIFR = _BV(PCIF0);
+  PCMSK0 |= _BV(NMEA_RX_PIN - 8);
+  PCICR |= _BV(PCIE0);
+  SREG = sreg;
+}
+
+void NMEASerial::end(void)
+{
+  uint8_t sreg = SREG;
+  cli();
+  PCMSK0 &= ~_BV(NMEA_RX_PIN - 8);
+  TCCR2B = 0;
+  TIMSK2 = 0;
+  SREG = sreg;
+}
+
+uint16_t NMEASerial::overflows(void)
+{
+  uint16_t n;
+  uint8_t sreg = SREG;
+  cli();
+  n = __overflows;
+  SREG = sreg;
+  return n;
+}
+
+uint16_t NMEASerial::framingErrors(void)
+{
+  uint16_t n;
+  uint8_t sreg = SREG;
+  cli();
+  n = __framingErrors;
+  SREG = sreg;
+  return n;
+}
+
+/*
+ * Bytes are stored by the interrupts, nothing to move.
+ */
+static inline void pump(void)
+{
+}
+
+#else /* host: the bits come from Serial1 of the native HAL */
+
+void NMEASerial::begin(uint32_t baud)
+{
+  Serial1.begin(baud);
+}
+
+void NMEASerial::end(void)
+{
+  Serial1.end();
+}
+
+uint16_t NMEASerial::overflows(void)
+{
+  return __overflows;
+}
+
+uint16_t NMEASerial::framingErrors(void)
+{
+  return __framingErrors;
+}
+
+/*
+ * Moves the bytes that arrived on the line into the ring buffer, as the
+ * interrupts would have done in the meantime.
+ */
+static void pump(void)
+{
+  int c;
+
+  while ((c = Serial1.read()) >= 0)
+    NMEASerial::onByte((uint8_t)c);
+}
+
+void NMEASerial::onPinChange(void)
+{
+}
+
+void NMEASerial::onBitTimer(void)
+{
+}
+
+#endif /* __AVR__ */
+
+int NMEASerial::available(void)
+{
+  pump();
+  return (uint8_t)(__head - __tail);
+}
+
+int NMEASerial::read(void)
+{
+  uint8_t c;
+
+  pump();
+  if (__head == __tail)
+    return -1;
+  c = __buffer[__tail & RX_MASK];
+  __tail = __tail + 1; // single byte store, so atomic for the interrupt
+  return c;
+}
+
+void NMEASerial::onByte(uint8_t c)
+{
+  if ((uint8_t)(__head - __tail) >= NMEA_RX_BUFFER_SIZE)
+  {
+    __overflows++;
+    return;
+  }
+  __buffer[__head & RX_MASK] = c;
+  __head = __head + 1;
+}
+
+#ifdef __AVR__
+/*
+ * Edge on the input: when it is the leading edge of a start bit, stop
+ * listening to edges and let the timer sample the 1st bit half a bit later.
+ */
+void NMEASerial::onPinChange(void)
+{
+  if (rxMark())
+    return;
+  PCMSK0 &= ~_BV(NMEA_RX_PIN - 8);
+  TCNT2 = bitTicks / 2;
+  TIFR2 = _BV(OCF2A);
+  bitState = 0;
+  TCCR2B = clockSelect;
+}
+
+/*
+ * Middle of a bit period: sample the bit.
+ */
+void NMEASerial::onBitTimer(void)
+{
+  bool mark = rxMark();
+
+  if (bitState == 0)
+  {
+    if (mark) // glitch, not a start bit
+    {
+      rxIdle();
+      return;
+    }
+    rxByte = 0;
+    bitState = 1;
+  }
+  else if (bitState <= 8)
+  {
+    rxByte >>= 1; // LSB comes first
+    if (mark)
+      rxByte |= 0x80;
+    bitState++;
+  }
+  else
+  {
+    if (mark)
+      onByte(rxByte);
+    else
+      __framingErrors++;
+    rxIdle();
+  }
+}
+
+ISR(PCINT0_vect)
+{
+  NMEASerial::onPinChange();
+}
+
+ISR(TIMER2_COMPA_vect)
+{
+  NMEASerial::onBitTimer();
+}
+#endif /* __AVR__ */
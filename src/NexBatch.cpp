@@ -0,0 +1,96 @@
+/**
+ * @file NexBatch.cpp
+ *
+ * The implementation of class NexBatch.
+ *
+ * @author  Roy Wassili (waps61 @gmail.com)
+ * @date    2020/09/08
+ */
+#include "NexBatch.h"
+
+NexBatch::NexBatch(bool hold_refresh)
+{
+    __count = 0;
+    __hold_refresh = hold_refresh;
+}
+
+bool NexBatch::add(NexObject &obj, const char *attr, uint32_t number)
+{
+    if (__count >= NEX_BATCH_SIZE)
+    {
+        return false;
+    }
+    __writes[__count].obj = &obj;
+    __writes[__count].attr = attr;
+    __writes[__count].text = NULL;
+    __writes[__count].number = number;
+    __count++;
+    return true;
+}
+
+bool NexBatch::add(NexObject &obj, const char *attr, const char *text)
+{
+    if (!text || !add(obj, attr, (uint32_t)0))
+    {
+        return false;
+    }
+    __writes[__count - 1].text = text;
+    return true;
+}
+
+bool NexBatch::flush(uint32_t timeout)
+{
+    uint8_t errors = 0;
+    uint8_t i;
+    bool ret;
+
+    if (0 == __count)
+    {
+        return true;
+    }
+
+    /* one burst; replies are only collected by nexSync() at the end */
+    sendCommandBegin();
+    if (__hold_refresh)
+    {
+        sendCommandAdd("ref_stop");
+        sendCommandEnd();
+    }
+    for (i = 0; i < __count; i++)
+    {
+        sendCommandAdd(__writes[i].obj->getObjName());
+        sendCommandAdd(".");
+        sendCommandAdd(__writes[i].attr);
+        if (__writes[i].text)
+        {
+            sendCommandAdd("=\"");
+            sendCommandAdd(__writes[i].text);
+            sendCommandAdd("\"");
+        }
+        else
+        {
+            sendCommandAdd("=");
+            sendCommandAdd(__writes[i].number);
+        }
+        sendCommandEnd();
+        /* the batch does not tell which write failed */
+        __writes[i].obj->cacheStore(false, 0);
+    }
+    if (__hold_refresh)
+    {
+        sendCommandAdd("ref_star");
+        sendCommandEnd();
+    }
+    __count = 0;
+
+    ret = nexSync(&errors, timeout) && 0 == errors;
+    if (ret)
+    {
+        dbSerialPrintln("NexBatch::flush ok");
+    }
+    else
+    {
+        dbSerialPrintln("NexBatch::flush err");
+    }
+    return ret;
+}
@@ -22,22 +22,22 @@ NexButton::NexButton(uint8_t pid, uint8_t cid, const char *name)
 
 uint16_t NexButton::getText(char *buffer, uint16_t len)
 {
-    String cmd;
-    cmd += "get ";
-    cmd += getObjName();
-    cmd += ".txt";
-    sendCommand(cmd.c_str());
+    sendCommandBegin();
+    sendCommandAdd("get ");
+    sendCommandAdd(getObjName());
+    sendCommandAdd(".txt");
+    sendCommandEnd();
     return recvRetString(buffer,len);
 }
 
 bool NexButton::setText(const char *buffer)
 {
-    String cmd;
-    cmd += getObjName();
-    cmd += ".txt=\"";
-    cmd += buffer;
-    cmd += "\"";
-    sendCommand(cmd.c_str());
+    sendCommandBegin();
+    sendCommandAdd(getObjName());
+    sendCommandAdd(".txt=\"");
+    sendCommandAdd(buffer);
+    sendCommandAdd("\"");
+    sendCommandEnd();
     return recvRetCommandFinished();    
 }
 
@@ -22,24 +22,37 @@ NexCrop::NexCrop(uint8_t pid, uint8_t cid, const char *name)
 
 bool NexCrop::getPic(uint32_t *number)
 {
-    String cmd = String("get ");
-    cmd += getObjName();
-    cmd += ".picc";
-    sendCommand(cmd.c_str());
-    return recvRetNumber(number);
+    bool ret;
+
+    if (cacheRead(number))
+    {
+        return true;
+    }
+    sendCommandBegin();
+    sendCommandAdd("get ");
+    sendCommandAdd(getObjName());
+    sendCommandAdd(".picc");
+    sendCommandEnd();
+    ret = recvRetNumber(number);
+    cacheStore(ret, ret ? *number : 0);
+    return ret;
 }
 
 bool NexCrop::setPic(uint32_t number)
 {
-    char buf[10] = {0};
-    String cmd;
-    
-    utoa(number, buf, 10);
-    cmd += getObjName();
-    cmd += ".picc=";
-    cmd += buf;
+    bool ret;
 
-    sendCommand(cmd.c_str());
-    return recvRetCommandFinished();
+    if (cacheHit(number))
+    {
+        return true;
+    }
+    sendCommandBegin();
+    sendCommandAdd(getObjName());
+    sendCommandAdd(".picc=");
+    sendCommandAdd(number);
+    sendCommandEnd();
+    ret = recvRetCommandFinished();
+    cacheStore(ret, number);
+    return ret;
 }
 
@@ -32,6 +32,397 @@
 #define NEX_RET_INVALID_VARIABLE        (0x1A)
 #define NEX_RET_INVALID_OPERATION       (0x1B)
 
+/*
+ * Write a command and its terminator, leaving the receive side alone. 
+ *
+ * @param cmd - the string of command.
+ */
+static void nexWriteCommand(const char* cmd)
+{
+    if (0 == strncmp(cmd, "page ", 5))
+    {
+        nexCacheInvalidate();
+    }
+    nexSerial.print(cmd);
+    nexSerial.write(0xFF);
+    nexSerial.write(0xFF);
+    nexSerial.write(0xFF);
+}
+
+/*
+ * Incremental frame reader. 
+ *
+ * Frames are collected byte by byte as they arrive, so reading never
+ * blocks. Frames with a fixed length (numbers, page ids, touch events) are
+ * cut at that length, as their payload may contain 0xFF; all others end at
+ * 0xFF 0xFF 0xFF, which is not stored. A fixed length frame without that
+ * terminator is shifted by one byte until the stream is in sync again. 
+ */
+#if NEX_REPLY_MAX_LEN < 8
+#error "NEX_REPLY_MAX_LEN must hold the longest fixed length frame"
+#endif
+
+#define NEX_FRAME_MAX   (NEX_REPLY_MAX_LEN + 1)
+
+static uint8_t __frame[NEX_FRAME_MAX];
+static uint8_t __frame_len = 0;     /* bytes stored in __frame */
+static uint8_t __frame_size = 0;    /* expected length, 0 = up to 0xFF 0xFF 0xFF */
+static uint8_t __frame_ff = 0;      /* trailing 0xFF count of a variable frame */
+
+static uint8_t nexFrameSize(uint8_t head)
+{
+    switch (head)
+    {
+        case NEX_RET_NUMBER_HEAD:               return 8;
+        case NEX_RET_CURRENT_PAGE_ID_HEAD:      return 5;
+        case NEX_RET_EVENT_TOUCH_HEAD:          return 7;
+        case NEX_RET_EVENT_POSITION_HEAD:       return 9;
+        case NEX_RET_EVENT_SLEEP_POSITION_HEAD: return 9;
+        case NEX_RET_STRING_HEAD:               return 0;
+        default:                                return 4;
+    }
+}
+
+static bool nexFrameTerminated(void)
+{
+    return __frame[__frame_len - 1] == 0xFF
+        && __frame[__frame_len - 2] == 0xFF
+        && __frame[__frame_len - 3] == 0xFF;
+}
+
+/*
+ * Read the bytes available until a frame is complete. 
+ *
+ * @retval true - a complete frame is in __frame; it is discarded by the
+ *  next call. 
+ * @retval false - no complete frame yet. 
+ */
+static bool nexReadFrame(void)
+{
+    uint8_t c;
+
+    if (__frame_size ? __frame_len == __frame_size : __frame_ff >= 3)
+    {
+        __frame_len = 0;
+        __frame_ff = 0;
+    }
+    while (nexSerial.available() > 0)
+    {
+        c = nexSerial.read();
+        if (__frame_len == 0)
+        {
+            __frame_size = nexFrameSize(c);
+        }
+        if (__frame_size == 0)
+        {
+            /* variable length: keep the head, truncate the payload */
+            __frame_ff = (0xFF == c) ? __frame_ff + 1 : 0;
+            if (0 == __frame_ff && __frame_len < NEX_FRAME_MAX)
+            {
+                __frame[__frame_len++] = c;
+            }
+            if (__frame_ff >= 3)
+            {
+                return true;
+            }
+            continue;
+        }
+        __frame[__frame_len++] = c;
+        while (__frame_len > 0 && __frame_len == __frame_size && !nexFrameTerminated())
+        {
+            /* out of sync, retry one byte further */
+            memmove(__frame, __frame + 1, --__frame_len);
+            __frame_size = nexFrameSize(__frame[0]);
+            if (__frame_size == 0 || __frame_len > __frame_size)
+            {
+                __frame_len = 0;
+            }
+        }
+        if (__frame_len > 0 && __frame_len == __frame_size)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * @retval true - head is a command finished or error reply. 
+ */
+static bool nexIsAck(uint8_t head)
+{
+    return NEX_RET_CMD_FINISHED == head
+        || NEX_RET_INVALID_CMD == head
+        || (head >= NEX_RET_INVALID_COMPONENT_ID && head <= 0x24);
+}
+
+/*
+ * Return stream demultiplexer. 
+ *
+ * Every frame read is routed by its head: command finished and error
+ * replies to the ack queue, number and string replies to the reply slot,
+ * touch events and all other (system) events to their own queues. The page
+ * id answering a queued sendme marker goes to the ack queue as well, so it
+ * is seen in order with the errors before it. So
+ * nothing gets lost while waiting for a reply and every consumer only sees
+ * the frames meant for it. While the ack queue is full the rest of the
+ * stream is left in the port until an ack has been collected, so no error
+ * reply is ever discarded. 
+ */
+struct NexEventQueue
+{
+    NexEvent ev[NEX_EVENT_QUEUE_SIZE];
+    uint8_t tail;                   /* oldest entry */
+    uint8_t count;
+};
+
+static uint8_t __acks[NEX_CMD_QUEUE_SIZE];
+static uint8_t __acks_tail = 0;
+static uint8_t __acks_count = 0;
+static uint8_t __reply_head = 0;    /* head of the reply in __reply, 0 = none */
+static uint8_t __reply_len = 0;
+static uint8_t __reply[NEX_REPLY_MAX_LEN];
+static NexEventQueue __touch_events;
+static NexEventQueue __system_events;
+static uint16_t __cache_gen = 1;    /* see nexCacheGeneration() */
+static uint8_t __page = 0xFF;       /* current page as far as known */
+static bool __sync_pending = false; /* nexSync() waits for the page id */
+static bool __sync_done = false;
+static uint8_t __sync_errors = 0;   /* error replies seen while nexSync() waits */
+static uint8_t __marks_pending = 0; /* queued sendme markers waiting for the page id */
+static NexLinkStats __link_stats = {0, 0, 0, 0, 0};
+
+static void nexPushEvent(NexEventQueue *q)
+{
+    NexEvent *ev;
+    uint8_t size = nexFrameSize(__frame[0]);
+
+    if (q->count >= NEX_EVENT_QUEUE_SIZE)
+    {
+        __link_stats.dropped++;
+        return;
+    }
+    ev = &q->ev[(q->tail + q->count) % NEX_EVENT_QUEUE_SIZE];
+    ev->head = __frame[0];
+    memset(ev->data, 0, sizeof(ev->data));
+    if (size > 4)
+    {
+        memcpy(ev->data, __frame + 1, size - 4);
+    }
+    q->count++;
+}
+
+static bool nexPopEvent(NexEventQueue *q, NexEvent *ev)
+{
+    if (0 == q->count)
+    {
+        return false;
+    }
+    *ev = q->ev[q->tail];
+    q->tail = (q->tail + 1) % NEX_EVENT_QUEUE_SIZE;
+    q->count--;
+    return true;
+}
+
+static bool nexPopAck(uint8_t *status)
+{
+    if (0 == __acks_count)
+    {
+        return false;
+    }
+    *status = __acks[__acks_tail];
+    __acks_tail = (__acks_tail + 1) % NEX_CMD_QUEUE_SIZE;
+    __acks_count--;
+    return true;
+}
+
+/*
+ * Keep track of the page shown; a reset or a new page invalidates every
+ * attribute cached. 
+ */
+static void nexTrackPage(uint8_t head)
+{
+    switch (head)
+    {
+        case NEX_RET_EVENT_LAUNCHED:
+        case NEX_RET_EVENT_UPGRADED:
+            __page = 0xFF;
+            nexCacheInvalidate();
+            break;
+        case NEX_RET_CURRENT_PAGE_ID_HEAD:
+        case NEX_RET_EVENT_TOUCH_HEAD:
+            if (__frame[1] != __page)
+            {
+                __page = __frame[1];
+                nexCacheInvalidate();
+            }
+            break;
+    }
+}
+
+static void nexDemux(void)
+{
+    uint8_t head;
+
+    while (__acks_count < NEX_CMD_QUEUE_SIZE && nexReadFrame())
+    {
+        head = __frame[0];
+        nexTrackPage(head);
+        if (nexIsAck(head) && __sync_pending)
+        {
+            /* counted here, so no burst of replies can overflow the queue */
+            if (NEX_RET_CMD_FINISHED != head && __sync_errors < 0xFF)
+            {
+                __sync_errors++;
+            }
+        }
+        else if (nexIsAck(head))
+        {
+            __acks[(__acks_tail + __acks_count) % NEX_CMD_QUEUE_SIZE] = head;
+            __acks_count++;
+        }
+        else if (NEX_RET_NUMBER_HEAD == head || NEX_RET_STRING_HEAD == head)
+        {
+            if (__reply_head)
+            {
+                /* the previous one was never collected */
+                __link_stats.late++;
+            }
+            __reply_head = head;
+            __reply_len = __frame_size ? __frame_size - 4 : __frame_len - 1;
+            memcpy(__reply, __frame + 1, __reply_len);
+        }
+        else if (NEX_RET_EVENT_TOUCH_HEAD == head
+            || NEX_RET_EVENT_POSITION_HEAD == head
+            || NEX_RET_EVENT_SLEEP_POSITION_HEAD == head)
+        {
+            nexPushEvent(&__touch_events);
+        }
+        else if (NEX_RET_CURRENT_PAGE_ID_HEAD == head && __sync_pending)
+        {
+            __sync_pending = false;
+            __sync_done = true;
+        }
+        else if (NEX_RET_CURRENT_PAGE_ID_HEAD == head && __marks_pending > 0)
+        {
+            __marks_pending--;
+            __acks[(__acks_tail + __acks_count) % NEX_CMD_QUEUE_SIZE] = head;
+            __acks_count++;
+        }
+        else
+        {
+            nexPushEvent(&__system_events);
+        }
+    }
+}
+
+/*
+ * Discard the replies to earlier commands still waiting to be collected. 
+ */
+static void nexDropReplies(void)
+{
+    uint8_t status;
+
+    /* every ack taken makes room for the next one still in the port */
+    for (nexDemux(); nexPopAck(&status); nexDemux())
+    {
+        __link_stats.late++;
+    }
+    if (__reply_head)
+    {
+        __reply_head = 0;
+        __link_stats.late++;
+    }
+}
+
+/*
+ * Wait for a number or string reply. 
+ *
+ * @return the head of the reply or 0 on an error reply or timeout; the
+ *  reply itself is in __reply until the next call. 
+ */
+static uint8_t nexWaitReply(uint32_t timeout)
+{
+    uint8_t head = 0;
+    uint8_t status;
+    uint32_t start = millis();
+
+    do
+    {
+        nexDemux();
+        if (__reply_head)
+        {
+            head = __reply_head;
+            __reply_head = 0;
+            break;
+        }
+        if (nexPopAck(&status) && NEX_RET_CMD_FINISHED != status)
+        {
+            break;
+        }
+    } while (millis() - start <= timeout);
+    return head;
+}
+
+uint16_t nexCacheGeneration(void)
+{
+    nexDemux();
+    return __cache_gen;
+}
+
+void nexCacheInvalidate(void)
+{
+    /* 0 never is a valid generation */
+    if (0 == ++__cache_gen)
+    {
+        __cache_gen = 1;
+    }
+}
+
+bool nexSync(uint8_t *errors, uint32_t timeout)
+{
+    uint8_t status;
+    uint8_t cnt = 0;
+    uint32_t start;
+
+    nexWriteCommand("sendme");
+    __sync_pending = true;
+    __sync_done = false;
+    __sync_errors = 0;
+    start = millis();
+    do
+    {
+        nexDemux();
+        while (nexPopAck(&status))
+        {
+            if (NEX_RET_CMD_FINISHED != status && cnt < 0xFF)
+            {
+                cnt++;
+            }
+        }
+    } while (!__sync_done && millis() - start <= timeout);
+    __sync_pending = false;
+
+    if (errors)
+    {
+        /* the acks queued before plus those counted by nexDemux() */
+        *errors = cnt > 0xFF - __sync_errors ? 0xFF : cnt + __sync_errors;
+    }
+    return __sync_done;
+}
+
+bool nexGetTouchEvent(NexEvent *ev)
+{
+    nexDemux();
+    return nexPopEvent(&__touch_events, ev);
+}
+
+bool nexGetSystemEvent(NexEvent *ev)
+{
+    nexDemux();
+    return nexPopEvent(&__system_events, ev);
+}
+
 /*
  * Receive uint32_t data. 
  * 
@@ -45,26 +436,16 @@
 bool recvRetNumber(uint32_t *number, uint32_t timeout)
 {
     bool ret = false;
-    uint8_t temp[8] = {0};
 
     if (!number)
     {
         goto __return;
     }
     
-    nexSerial.setTimeout(timeout);
-    if (sizeof(temp) != nexSerial.readBytes((char *)temp, sizeof(temp)))
-    {
-        goto __return;
-    }
-
-    if (temp[0] == NEX_RET_NUMBER_HEAD
-        && temp[5] == 0xFF
-        && temp[6] == 0xFF
-        && temp[7] == 0xFF
-        )
+    if (NEX_RET_NUMBER_HEAD == nexWaitReply(timeout) && 4 == __reply_len)
     {
-        *number = (temp[4] << 24) | (temp[3] << 16) | (temp[2] << 8) | (temp[1]);
+        *number = ((uint32_t)__reply[3] << 24) | ((uint32_t)__reply[2] << 16) 
+            | ((uint32_t)__reply[1] << 8) | (__reply[0]);
         ret = true;
     }
 
@@ -97,60 +478,22 @@ __return:
 uint16_t recvRetString(char *buffer, uint16_t len, uint32_t timeout)
 {
     uint16_t ret = 0;
-    bool str_start_flag = false;
-    uint8_t cnt_0xff = 0;
-    String temp = String("");
-    uint8_t c = 0;
-    long start;
 
     if (!buffer || len == 0)
     {
         goto __return;
     }
     
-    start = millis();
-    while (millis() - start <= timeout)
+    if (NEX_RET_STRING_HEAD == nexWaitReply(timeout))
     {
-        while (nexSerial.available())
-        {
-            c = nexSerial.read();
-            if (str_start_flag)
-            {
-                if (0xFF == c)
-                {
-                    cnt_0xff++;                    
-                    if (cnt_0xff >= 3)
-                    {
-                        break;
-                    }
-                }
-                else
-                {
-                    temp += (char)c;
-                }
-            }
-            else if (NEX_RET_STRING_HEAD == c)
-            {
-                str_start_flag = true;
-            }
-        }
-        
-        if (cnt_0xff >= 3)
-        {
-            break;
-        }
+        ret = __reply_len > len ? len : __reply_len;
+        strncpy(buffer, (const char *)__reply, ret);
     }
-
-    ret = temp.length();
-    ret = ret > len ? len : ret;
-    strncpy(buffer, temp.c_str(), ret);
     
 __return:
 
     dbSerialPrint("recvRetString[");
-    dbSerialPrint(temp.length());
-    dbSerialPrint(",");
-    dbSerialPrint(temp);
+    dbSerialPrint(ret);
     dbSerialPrintln("]");
 
     return ret;
@@ -163,21 +506,45 @@ __return:
  */
 void sendCommand(const char* cmd)
 {
-    while (nexSerial.available())
-    {
-        nexSerial.read();
-    }
+    nexDropReplies();
+    nexWriteCommand(cmd);
+}
+
+void sendCommandBegin(void)
+{
+    nexDropReplies();
+}
+
+void sendCommandAdd(const char *str)
+{
+    nexSerial.print(str);
+}
+
+void sendCommandAdd(uint32_t number)
+{
+    char buf[11];
     
-    nexSerial.print(cmd);
+    ultoa(number, buf, 10);
+    nexSerial.print(buf);
+}
+
+void sendCommandEnd(void)
+{
     nexSerial.write(0xFF);
     nexSerial.write(0xFF);
     nexSerial.write(0xFF);
 }
 
 
+static uint8_t __response_mode = NEX_BKCMD_SUCCESS;
+
 /*
  * Command is executed successfully. 
  *
+ * Without success replies (bkcmd=0/2) there is nothing to wait for: with
+ * bkcmd=0 the command counts as executed, with bkcmd=2 nexSync() confirms
+ * it, as the page id comes right after the error the command may cause. 
+ *
  * @param timeout - set timeout time.
  *
  * @retval true - success.
@@ -187,21 +554,31 @@ void sendCommand(const char* cmd)
 bool recvRetCommandFinished(uint32_t timeout)
 {    
     bool ret = false;
-    uint8_t temp[4] = {0};
+    uint8_t status = NEX_ACK_TIMEOUT;
+    uint32_t start;
     
-    nexSerial.setTimeout(timeout);
-    if (sizeof(temp) != nexSerial.readBytes((char *)temp, sizeof(temp)))
+    if (NEX_BKCMD_NONE == __response_mode)
     {
-        ret = false;
+        return true;
     }
 
-    if (temp[0] == NEX_RET_CMD_FINISHED
-        && temp[1] == 0xFF
-        && temp[2] == 0xFF
-        && temp[3] == 0xFF
-        )
+    if (!(__response_mode & NEX_BKCMD_SUCCESS))
     {
-        ret = true;
+        /* only an error can come */
+        ret = nexSync(&status, timeout) && 0 == status;
+    }
+    else
+    {
+        start = millis();
+        do
+        {
+            nexDemux();
+            if (nexPopAck(&status))
+            {
+                break;
+            }
+        } while (millis() - start <= timeout);
+        ret = (NEX_RET_CMD_FINISHED == status);
     }
 
     if (ret) 
@@ -217,52 +594,341 @@ bool recvRetCommandFinished(uint32_t timeout)
 }
 
 
+static const uint32_t __baud_rates[] = {NEX_BAUD_RATES};
+static uint32_t __baud = 0;
+static uint32_t __latency = 0;
+
+/*
+ * Switch the port to baud and test the link with a round trip. 
+ */
+static bool nexTryBaud(uint32_t baud)
+{
+    nexSerial.begin(baud);
+    /* terminate whatever Nextion made of bytes sent at another rate */
+    sendCommand("");
+    return nexSync(NULL, NEX_BAUD_TIMEOUT);
+}
+
+/*
+ * Move Nextion to baud; the link has to work at the current rate. 
+ */
+static bool nexUpgradeBaud(uint32_t baud)
+{
+    char cmd[16] = "baud=";
+
+    ultoa(baud, cmd + 5, 10);
+    sendCommand(cmd);
+    nexSerial.flush();
+    return nexTryBaud(baud);
+}
+
+/*
+ * Time in ms to wait for the reply to a short command. 
+ */
+static uint32_t nexReplyTimeout(void)
+{
+    return __latency / 1000 + 2;
+}
+
+uint32_t nexNegotiateBaud(void)
+{
+    const uint8_t n = sizeof(__baud_rates) / sizeof(__baud_rates[0]);
+    uint32_t start;
+    uint32_t total = 0;
+    uint8_t i;
+    uint8_t ok = 0;
+
+    __baud = 0;
+    __latency = 0;
+    for (i = 0; i < n && !__baud; i++)
+    {
+        if (nexTryBaud(__baud_rates[i]))
+        {
+            __baud = __baud_rates[i];
+        }
+    }
+    if (!__baud)
+    {
+        dbSerialPrintln("nexNegotiateBaud err");
+        return 0;
+    }
+
+    /* the faster rates listed come first */
+    for (i = 0; __baud_rates[i] != __baud; i++)
+    {
+        if (nexUpgradeBaud(__baud_rates[i]))
+        {
+            __baud = __baud_rates[i];
+            break;
+        }
+        /* not carried by the link; try to get Nextion back blindly */
+        nexWriteCommand("");
+        nexUpgradeBaud(__baud);
+        if (!nexTryBaud(__baud))
+        {
+            __baud = 0;
+            dbSerialPrintln("nexNegotiateBaud lost");
+            return 0;
+        }
+    }
+
+    for (i = 0; i < 4; i++)
+    {
+        start = micros();
+        if (nexSync(NULL, NEX_BAUD_TIMEOUT))
+        {
+            total += micros() - start;
+            ok++;
+        }
+    }
+    __latency = ok ? total / ok : 0;
+
+    dbSerialPrint("nexNegotiateBaud ");
+    dbSerialPrintln(__baud);
+    return __baud;
+}
+
+uint32_t nexBaud(void)
+{
+    return __baud;
+}
+
+uint32_t nexLatency(void)
+{
+    return __latency;
+}
+
 bool nexInit(void)
 {
     bool ret1 = false;
     bool ret2 = false;
     
     dbSerialBegin(115200);
-    nexSerial.begin(115200);
-    sendCommand("");
-    sendCommand("bkcmd=1");
-    ret1 = recvRetCommandFinished(1);
+    nexCacheInvalidate();
+    ret1 = nexNegotiateBaud() != 0;
+    ret1 = nexSetResponseMode(NEX_RESPONSE_MODE) && ret1;
     sendCommand("page 0");
-    ret2 = recvRetCommandFinished(1);
+    ret2 = recvRetCommandFinished(nexReplyTimeout());
     delay(1000);
     return ret1 && ret2;
 }
 
+bool nexSetResponseMode(uint8_t mode)
+{
+    char cmd[] = "bkcmd=0";
+
+    cmd[6] += mode & NEX_BKCMD_ALL;
+    sendCommand(cmd);
+    /* Nextion replies to bkcmd itself in the new mode already */
+    __response_mode = mode & NEX_BKCMD_ALL;
+    return recvRetCommandFinished(nexReplyTimeout());
+}
+
+uint8_t nexResponseMode(void)
+{
+    return __response_mode;
+}
+
 void nexLoop(NexTouch *nex_listen_list[])
 {
-    static uint8_t __buffer[10];
-    
-    uint16_t i;
-    uint8_t c;  
+    NexEvent ev;
     
-    while (nexSerial.available() > 0)
-    {   
-        delay(10);
-        c = nexSerial.read();
-        
-        if (NEX_RET_EVENT_TOUCH_HEAD == c)
+    while (nexGetTouchEvent(&ev))
+    {
+        if (NEX_RET_EVENT_TOUCH_HEAD == ev.head)
         {
-            if (nexSerial.available() >= 6)
+            NexTouch::iterate(nex_listen_list, ev.data[0], ev.data[1], (int32_t)ev.data[2]);
+        }
+    }
+}
+
+/*
+ * Command pipeline. 
+ */
+struct NexQueuedCmd
+{
+    char cmd[NEX_CMD_MAX_LEN];
+    NexAckCb cb;
+    void *ptr;
+    uint32_t sent;                  /* millis() the command was sent */
+};
+
+static NexQueuedCmd __cmd_queue[NEX_CMD_QUEUE_SIZE];
+static uint8_t __cmd_head = 0;      /* next free entry */
+static uint8_t __cmd_tail = 0;      /* oldest entry */
+static uint8_t __cmd_count = 0;
+static uint8_t __cmd_sent = 0;      /* entries from __cmd_tail on waiting for their outcome */
+static uint8_t __stale_acks = 0;    /* replies still due for timed out commands */
+static uint32_t __stale_since = 0;  /* millis() the last command timed out */
+
+bool nexQueueCommand(const char *cmd, NexAckCb cb, void *ptr)
+{
+    NexQueuedCmd *q;
+
+    if (__cmd_count >= NEX_CMD_QUEUE_SIZE || strlen(cmd) >= NEX_CMD_MAX_LEN)
+    {
+        return false;
+    }
+    q = &__cmd_queue[__cmd_head];
+    strcpy(q->cmd, cmd);
+    q->cb = cb;
+    q->ptr = ptr;
+    __cmd_head = (__cmd_head + 1) % NEX_CMD_QUEUE_SIZE;
+    __cmd_count++;
+    return true;
+}
+
+/*
+ * A queued "sendme" is a marker: its page id reply comes after the replies
+ * to every command sent before it. 
+ */
+static bool nexIsMarker(const NexQueuedCmd *q)
+{
+    return 0 == strcmp(q->cmd, "sendme");
+}
+
+/*
+ * Retire the oldest command sent and report its outcome. 
+ */
+static void nexCompleteCommand(uint8_t status)
+{
+    NexQueuedCmd *q = &__cmd_queue[__cmd_tail];
+
+    __cmd_sent--;
+    __cmd_tail = (__cmd_tail + 1) % NEX_CMD_QUEUE_SIZE;
+    __cmd_count--;
+
+    if (NEX_ACK_OK == status)
+    {
+        __link_stats.acked++;
+    }
+    else if (NEX_ACK_TIMEOUT == status)
+    {
+        __link_stats.timeouts++;
+    }
+    else
+    {
+        __link_stats.failed++;
+        dbSerialPrint("nexPoll err ");
+        dbSerialPrintln(q->cmd);
+    }
+    if (q->cb)
+    {
+        q->cb(status, q->ptr);
+    }
+}
+
+void nexPoll(void)
+{
+    uint8_t head;
+    NexQueuedCmd *q;
+
+    for (nexDemux(); nexPopAck(&head); nexDemux())
+    {
+        if (NEX_RET_CURRENT_PAGE_ID_HEAD == head)
+        {
+            /* no error came before the marker, so all sent up to it is done */
+            while (__cmd_sent > 0 && !nexIsMarker(&__cmd_queue[__cmd_tail]))
+            {
+                nexCompleteCommand(NEX_ACK_OK);
+            }
+            if (__cmd_sent > 0)
             {
-                __buffer[0] = c;  
-                for (i = 1; i < 7; i++)
-                {
-                    __buffer[i] = nexSerial.read();
-                }
-                __buffer[i] = 0x00;
-                
-                if (0xFF == __buffer[4] && 0xFF == __buffer[5] && 0xFF == __buffer[6])
-                {
-                    NexTouch::iterate(nex_listen_list, __buffer[1], __buffer[2], (int32_t)__buffer[3]);
-                }
-                
+                nexCompleteCommand(NEX_ACK_OK);
             }
+            else
+            {
+                /* its marker already timed out */
+                __link_stats.late++;
+            }
+            continue;
+        }
+        if (!(__response_mode & (NEX_RET_CMD_FINISHED == head ? NEX_BKCMD_SUCCESS : NEX_BKCMD_ERRORS)))
+        {
+            /* a reply the current mode does not produce, i.e. left over from before */
+            continue;
+        }
+        if (__stale_acks > 0)
+        {
+            /* belongs to a command that already timed out */
+            __stale_acks--;
+            __link_stats.late++;
+        }
+        else if (__cmd_sent > 0 && !nexIsMarker(&__cmd_queue[__cmd_tail]))
+        {
+            nexCompleteCommand(head);
+        }
+        else
+        {
+            /* an error after its command counted as done */
+            __link_stats.late++;
+        }
+    }
+    if (__stale_acks > 0 && millis() - __stale_since > NEX_CMD_TIMEOUT)
+    {
+        /* a failure under bkcmd=1 or a garbled frame leaves no reply to wait for */
+        __stale_acks = 0;
+    }
+
+    while (__cmd_sent > 0 && millis() - __cmd_queue[__cmd_tail].sent > NEX_CMD_TIMEOUT)
+    {
+        if (nexIsMarker(&__cmd_queue[__cmd_tail]))
+        {
+            /* a late page id goes to the system events again */
+            if (__marks_pending > 0)
+            {
+                __marks_pending--;
+            }
+            nexCompleteCommand(NEX_ACK_TIMEOUT);
+        }
+        else if (__response_mode & NEX_BKCMD_SUCCESS)
+        {
+            if (__stale_acks < 0xFF)
+            {
+                __stale_acks++;
+            }
+            __stale_since = millis();
+            nexCompleteCommand(NEX_ACK_TIMEOUT);
+        }
+        else
+        {
+            /* no error in time, so it was executed */
+            nexCompleteCommand(NEX_ACK_OK);
+        }
+    }
+
+    /*
+     * One command at a time, so a reply can only be for the command in
+     * flight; without success replies a marker may follow it right away,
+     * as an error can only come before the page id it sends back. 
+     */
+    while (__cmd_sent < __cmd_count)
+    {
+        q = &__cmd_queue[(__cmd_tail + __cmd_sent) % NEX_CMD_QUEUE_SIZE];
+        if (__cmd_sent > 0 && ((__response_mode & NEX_BKCMD_SUCCESS) || !nexIsMarker(q)))
+        {
+            break;
+        }
+        nexWriteCommand(q->cmd);
+        q->sent = millis();
+        __cmd_sent++;
+        if (NEX_BKCMD_NONE == __response_mode)
+        {
+            nexCompleteCommand(NEX_ACK_OK);
+        }
+        else if (nexIsMarker(q))
+        {
+            __marks_pending++;
         }
     }
 }
 
+uint8_t nexPending(void)
+{
+    return __cmd_count;
+}
+
+const NexLinkStats *nexLinkStats(void)
+{
+    return &__link_stats;
+}
@@ -13,12 +13,18 @@
  * the License, or (at your option) any later version.
  */
 #include "NexObject.h"
+#include "NexHardware.h"
 
 NexObject::NexObject(uint8_t pid, uint8_t cid, const char *name)
 {
     this->__pid = pid;
     this->__cid = cid;
     this->__name = name;
+#ifdef NEX_CACHE_ENABLE
+    this->__cache_mode = NEX_CACHE_OFF;
+    this->__cache_gen = 0;
+    this->__cache = 0;
+#endif
 }
 
 uint8_t NexObject::getObjPid(void)
@@ -36,6 +42,63 @@ const char* NexObject::getObjName(void)
     return __name;
 }
 
+#ifdef NEX_CACHE_ENABLE
+void NexObject::setCacheMode(uint8_t mode)
+{
+    __cache_mode = mode;
+    __cache_gen = 0;
+}
+
+bool NexObject::cacheRead(uint32_t *number)
+{
+    if (NEX_CACHE_ALL != __cache_mode || !number
+        || __cache_gen != nexCacheGeneration())
+    {
+        return false;
+    }
+    *number = __cache;
+    return true;
+}
+
+bool NexObject::cacheHit(uint32_t number)
+{
+    return NEX_CACHE_OFF != __cache_mode
+        && __cache == number
+        && __cache_gen == nexCacheGeneration();
+}
+
+void NexObject::cacheStore(bool ok, uint32_t number)
+{
+    if (ok && NEX_CACHE_OFF != __cache_mode)
+    {
+        __cache = number;
+        __cache_gen = nexCacheGeneration();
+    }
+    else
+    {
+        __cache_gen = 0;
+    }
+}
+#else /* every read and write goes to Nextion */
+void NexObject::setCacheMode(uint8_t)
+{
+}
+
+bool NexObject::cacheRead(uint32_t *)
+{
+    return false;
+}
+
+bool NexObject::cacheHit(uint32_t)
+{
+    return false;
+}
+
+void NexObject::cacheStore(bool, uint32_t)
+{
+}
+#endif
+
 void NexObject::printObjInfo(void)
 {
     dbSerialPrint("[");
@@ -30,9 +30,11 @@ bool NexPage::show(void)
         return false;
     }
     
-    String cmd = String("page ");
-    cmd += name;
-    sendCommand(cmd.c_str());
+    nexCacheInvalidate();
+    sendCommandBegin();
+    sendCommandAdd("page ");
+    sendCommandAdd(name);
+    sendCommandEnd();
     return recvRetCommandFinished();
 }
 
@@ -22,24 +22,37 @@ NexPicture::NexPicture(uint8_t pid, uint8_t cid, const char *name)
 
 bool NexPicture::getPic(uint32_t *number)
 {
-    String cmd = String("get ");
-    cmd += getObjName();
-    cmd += ".pic";
-    sendCommand(cmd.c_str());
-    return recvRetNumber(number);
+    bool ret;
+
+    if (cacheRead(number))
+    {
+        return true;
+    }
+    sendCommandBegin();
+    sendCommandAdd("get ");
+    sendCommandAdd(getObjName());
+    sendCommandAdd(".pic");
+    sendCommandEnd();
+    ret = recvRetNumber(number);
+    cacheStore(ret, ret ? *number : 0);
+    return ret;
 }
 
 bool NexPicture::setPic(uint32_t number)
 {
-    char buf[10] = {0};
-    String cmd;
-    
-    utoa(number, buf, 10);
-    cmd += getObjName();
-    cmd += ".pic=";
-    cmd += buf;
+    bool ret;
 
-    sendCommand(cmd.c_str());
-    return recvRetCommandFinished();
+    if (cacheHit(number))
+    {
+        return true;
+    }
+    sendCommandBegin();
+    sendCommandAdd(getObjName());
+    sendCommandAdd(".pic=");
+    sendCommandAdd(number);
+    sendCommandEnd();
+    ret = recvRetCommandFinished();
+    cacheStore(ret, number);
+    return ret;
 }
  
@@ -21,24 +21,37 @@ NexSlider::NexSlider(uint8_t pid, uint8_t cid, const char *name)
 
 bool NexSlider::getValue(uint32_t *number)
 {
-    String cmd = String("get ");
-    cmd += getObjName();
-    cmd += ".val";
-    sendCommand(cmd.c_str());
-    return recvRetNumber(number);
+    bool ret;
+
+    if (cacheRead(number))
+    {
+        return true;
+    }
+    sendCommandBegin();
+    sendCommandAdd("get ");
+    sendCommandAdd(getObjName());
+    sendCommandAdd(".val");
+    sendCommandEnd();
+    ret = recvRetNumber(number);
+    cacheStore(ret, ret ? *number : 0);
+    return ret;
 }
 
 bool NexSlider::setValue(uint32_t number)
 {
-    char buf[10] = {0};
-    String cmd;
-    
-    utoa(number, buf, 10);
-    cmd += getObjName();
-    cmd += ".val=";
-    cmd += buf;
+    bool ret;
 
-    sendCommand(cmd.c_str());
-    return recvRetCommandFinished();
+    if (cacheHit(number))
+    {
+        return true;
+    }
+    sendCommandBegin();
+    sendCommandAdd(getObjName());
+    sendCommandAdd(".val=");
+    sendCommandAdd(number);
+    sendCommandEnd();
+    ret = recvRetCommandFinished();
+    cacheStore(ret, number);
+    return ret;
 }
 
@@ -21,50 +21,42 @@ NexText::NexText(uint8_t pid, uint8_t cid, const char *name)
 
 uint16_t NexText::getText(char *buffer, uint16_t len)
 {
-    String cmd;
-    cmd += "get ";
-    cmd += getObjName();
-    cmd += ".txt";
-    sendCommand(cmd.c_str());
+    sendCommandBegin();
+    sendCommandAdd("get ");
+    sendCommandAdd(getObjName());
+    sendCommandAdd(".txt");
+    sendCommandEnd();
     return recvRetString(buffer,len);
 }
 
 bool NexText::setText(const char *buffer)
 {
-    String cmd;
-    cmd += getObjName();
-    cmd += ".txt=\"";
-    cmd += buffer;
-    cmd += "\"";
-    sendCommand(cmd.c_str());
+    sendCommandBegin();
+    sendCommandAdd(getObjName());
+    sendCommandAdd(".txt=\"");
+    sendCommandAdd(buffer);
+    sendCommandAdd("\"");
+    sendCommandEnd();
     return recvRetCommandFinished();    
 }
 
 bool NexText::setBkColor(uint32_t number)
 {
-    char buf[10] = {0};
-    String cmd;
-    
-    utoa(number, buf, 10);
-    cmd += getObjName();
-    cmd += ".bco=";
-    cmd += buf;
-
-    sendCommand(cmd.c_str());
+    sendCommandBegin();
+    sendCommandAdd(getObjName());
+    sendCommandAdd(".bco=");
+    sendCommandAdd(number);
+    sendCommandEnd();
     return recvRetCommandFinished();
 }
 
 bool NexText::setFgColor(uint32_t number)
 {
-    char buf[10] = {0};
-    String cmd;
-    
-    utoa(number, buf, 10);
-    cmd += getObjName();
-    cmd += ".pco=";
-    cmd += buf;
-
-    sendCommand(cmd.c_str());
+    sendCommandBegin();
+    sendCommandAdd(getObjName());
+    sendCommandAdd(".pco=");
+    sendCommandAdd(number);
+    sendCommandEnd();
     return recvRetCommandFinished();
 }
 
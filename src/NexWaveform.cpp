@@ -21,16 +21,19 @@ NexWaveform::NexWaveform(uint8_t pid, uint8_t cid, const char *name)
 
 bool NexWaveform::addValue(uint8_t ch, uint8_t number)
 {
-    char buf[15] = {0};
-    
     if (ch > 3)
     {
         return false;
     }
     
-    sprintf(buf, "add %u,%u,%u", getObjCid(), ch, number);
-
-    sendCommand(buf);
+    sendCommandBegin();
+    sendCommandAdd("add ");
+    sendCommandAdd(getObjCid());
+    sendCommandAdd(",");
+    sendCommandAdd(ch);
+    sendCommandAdd(",");
+    sendCommandAdd(number);
+    sendCommandEnd();
     return true;
 }
  
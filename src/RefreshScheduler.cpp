@@ -0,0 +1,71 @@
+/**
+ * @file RefreshScheduler.cpp
+ *
+ * The implementation of class RefreshScheduler.
+ *
+ * @author  Roy Wassili (waps61 @gmail.com)
+ * @date    2020/09/09
+ */
+#include "RefreshScheduler.h"
+
+RefreshScheduler::RefreshScheduler(uint16_t minInterval, uint16_t maxInterval)
+{
+  __min = minInterval;
+  __max = maxInterval;
+  begin(0, 0);
+}
+
+void RefreshScheduler::begin(uint32_t now, uint32_t latency)
+{
+  uint32_t ms = latency / 1000;
+
+  __latency = ms > 0x1FFF ? 0xFFFF : ms << 3;
+  __interval = ms > __min ? (ms < __max ? ms : __max) : __min;
+  __credit = REFRESH_BURST * __interval;
+  __refill = now;
+  __sentAt = now;
+}
+
+bool RefreshScheduler::ready(uint32_t now)
+{
+  uint32_t credit = __credit + (now - __refill);
+  uint32_t full = (uint32_t)REFRESH_BURST * __interval;
+
+  __credit = credit > full ? full : credit;
+  __refill = now;
+  return __credit >= __interval;
+}
+
+void RefreshScheduler::sent(uint32_t now)
+{
+  __credit = __credit > __interval ? __credit - __interval : 0;
+  __sentAt = now;
+}
+
+void RefreshScheduler::done(uint32_t now, bool ok, bool replied)
+{
+  uint32_t sample = now - __sentAt;
+  uint16_t floor;
+
+  if (!ok)
+  {
+    // back off hard, the HMI or the link cannot keep up
+    __interval = __interval > __max / 2 ? __max : __interval * 2;
+    return;
+  }
+
+  if (replied)
+  {
+    if (sample > 0x1FFF)
+      sample = 0x1FFF;
+    __latency += ((int32_t)(sample << 3) - (int32_t)__latency) / 8;
+  }
+
+  // never faster than the HMI shows or than it acknowledges; close 1/8 of
+  // the gap per update, so a back off is undone in some 30 updates
+  floor = latency() > __min ? latency() : __min;
+  if (__interval > floor)
+    __interval -= (__interval - floor) / 8 + 1;
+  else
+    __interval = floor;
+}
@@ -0,0 +1,62 @@
+/**
+ * @file TrueWind.cpp
+ *
+ * The implementation of the true wind computation.
+ *
+ * @author  Roy Wassili (waps61 @gmail.com)
+ * @date    2020/09/11
+ */
+#include "TrueWind.h"
+#include "WindMath.h"
+
+void trueWindSolve(int16_t awa, int16_t aws, int16_t sog, int16_t cog,
+                   int16_t *tws, int16_t *twa, int16_t *twd)
+{
+  // Q15 sums of at most 2 * 32767^2, within 31 bits
+  int32_t x = (int32_t)aws * windCos(awa) - (int32_t)sog * WIND_Q15;
+  int32_t y = (int32_t)aws * windSin(awa);
+  int16_t a = windAtan2(y, x);
+  int32_t len;
+
+  // to 1/4 tenths with a shift instead of a 32-bit division, and the
+  // projection on the angle with sin and cos in Q13, so the largest
+  // length, 4 * 2 * 32767 times 8192, still fits in 31 bits
+  x = (x + 4096) >> 13;
+  y = (y + 4096) >> 13;
+  len = (x * ((windCos(a) + 2) >> 2) + y * ((windSin(a) + 2) >> 2) + 16384) >> 15;
+
+  *tws = len < 0 ? 0 : (len > WIND_VALUE_MAX ? WIND_VALUE_MAX : len);
+  *twa = a > 1800 ? a - 3600 : a;
+  *twd = windNormalize(cog + a);
+}
+
+bool trueWindUpdate(TrueWindInput *last, WindState *w, uint32_t now)
+{
+  uint8_t valid = w->awa.valid | w->aws.valid << 1 | w->sog.valid << 2 | w->cog.valid << 3;
+  int16_t tws, twa, twd;
+
+  if (valid == last->valid && w->awa.value == last->awa && w->aws.value == last->aws &&
+      w->sog.value == last->sog && w->cog.value == last->cog)
+    return false;
+  last->awa = w->awa.value;
+  last->aws = w->aws.value;
+  last->sog = w->sog.value;
+  last->cog = w->cog.value;
+  last->valid = valid;
+
+  if ((valid & 0x07) != 0x07)
+  {
+    windInvalidate(&w->tws, now);
+    windInvalidate(&w->twa, now);
+    windInvalidate(&w->twd, now);
+    return false;
+  }
+  trueWindSolve(w->awa.value, w->aws.value, w->sog.value, w->cog.value, &tws, &twa, &twd);
+  windSet(&w->tws, tws, now);
+  windSet(&w->twa, twa, now);
+  if (valid & 0x08)
+    windSet(&w->twd, twd, now);
+  else
+    windInvalidate(&w->twd, now);
+  return true;
+}
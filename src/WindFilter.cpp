@@ -0,0 +1,61 @@
+/**
+ * @file WindFilter.cpp
+ *
+ * The implementation of the damping filters.
+ *
+ * @author  Roy Wassili (waps61 @gmail.com)
+ * @date    2020/09/10
+ */
+#include "WindFilter.h"
+#include "WindMath.h"
+
+#define WEIGHT_SHIFT 12 // sample weights are Q12
+#define WEIGHT_ONE (1 << WEIGHT_SHIFT)
+
+/*
+ * Weight of a new sample: dt / (tau + dt), so WEIGHT_ONE means the sample
+ * replaces the average. Restarts the filter after a gap.
+ */
+static uint16_t sampleWeight(uint16_t tau, bool *primed, uint32_t *updated, uint32_t now)
+{
+  uint32_t dt = now - *updated;
+
+  *updated = now;
+  if (!*primed || tau == 0 || dt >= 4UL * tau)
+  {
+    *primed = true;
+    return WEIGHT_ONE;
+  }
+  return (dt << WEIGHT_SHIFT) / (tau + dt);
+}
+
+int16_t windFilter(WindScalarFilter *f, int16_t value, uint32_t now)
+{
+  uint16_t w = sampleWeight(f->tau, &f->primed, &f->updated, now);
+  int32_t sample = (int32_t)value << 3;
+
+  if (w == WEIGHT_ONE)
+    f->value = sample;
+  else
+    f->value += ((sample - f->value) * w + WEIGHT_ONE / 2) >> WEIGHT_SHIFT;
+  // back to tenths, rounded
+  return (int16_t)((f->value + 4) >> 3);
+}
+
+int16_t windFilter(WindAngleFilter *f, int16_t tenths, uint32_t now)
+{
+  uint16_t w = sampleWeight(f->tau, &f->primed, &f->updated, now);
+  // Q18 keeps the product with the weight within 31 bits
+  int32_t x = (int32_t)windCos(tenths) << 3;
+  int32_t y = (int32_t)windSin(tenths) << 3;
+
+  if (w == WEIGHT_ONE)
+  {
+    f->x = x;
+    f->y = y;
+    return windNormalize(tenths);
+  }
+  f->x += ((x - f->x) * w + WEIGHT_ONE / 2) >> WEIGHT_SHIFT;
+  f->y += ((y - f->y) * w + WEIGHT_ONE / 2) >> WEIGHT_SHIFT;
+  return windAtan2(f->y, f->x);
+}
@@ -0,0 +1,109 @@
+/**
+ * @file WindMath.cpp
+ *
+ * The implementation of the fixed-point trigonometry.
+ *
+ * @author  Roy Wassili (waps61 @gmail.com)
+ * @date    2020/09/10
+ */
+#include "WindMath.h"
+
+// sin(0..90 deg) in whole degrees, Q15
+static const uint16_t sinTable[91] PROGMEM = {
+    0, 572, 1144, 1715, 2286, 2856, 3425, 3993, 4560, 5126,
+    5690, 6252, 6813, 7371, 7927, 8481, 9032, 9580, 10126, 10668,
+    11207, 11743, 12275, 12803, 13328, 13848, 14364, 14876, 15383, 15886,
+    16383, 16876, 17364, 17846, 18323, 18794, 19260, 19720, 20173, 20621,
+    21062, 21497, 21925, 22347, 22762, 23170, 23571, 23964, 24351, 24730,
+    25101, 25465, 25821, 26169, 26509, 26841, 27165, 27481, 27788, 28087,
+    28377, 28659, 28932, 29196, 29451, 29697, 29934, 30162, 30381, 30591,
+    30791, 30982, 31163, 31335, 31498, 31650, 31794, 31927, 32051, 32165,
+    32269, 32364, 32448, 32523, 32587, 32642, 32687, 32722, 32747, 32762,
+    32767};
+
+// atan(i / 64) for i = 0..64 in 0.01 deg
+static const uint16_t atanTable[65] PROGMEM = {
+    0, 90, 179, 268, 358, 447, 536, 624, 713, 800,
+    888, 975, 1062, 1148, 1234, 1319, 1404, 1488, 1571, 1653,
+    1735, 1817, 1897, 1977, 2056, 2134, 2211, 2287, 2363, 2438,
+    2511, 2584, 2657, 2728, 2798, 2867, 2936, 3003, 3070, 3136,
+    3201, 3264, 3327, 3390, 3451, 3511, 3571, 3629, 3687, 3744,
+    3800, 3855, 3909, 3963, 4016, 4067, 4119, 4169, 4218, 4267,
+    4315, 4363, 4409, 4455, 4500};
+
+int16_t windNormalize(int16_t tenths)
+{
+  while (tenths < 0)
+    tenths += 3600;
+  while (tenths >= 3600)
+    tenths -= 3600;
+  return tenths;
+}
+
+/*
+ * sin of 0..900 tenths of a degree, interpolated between whole degrees.
+ */
+static int16_t quarterSin(uint16_t tenths)
+{
+  // (x * 6554) >> 16 is x / 10 for x <= 900, without a division
+  uint16_t i = ((uint32_t)tenths * 6554) >> 16;
+  uint8_t frac = tenths - i * 10;
+  int16_t v0 = pgm_read_word(&sinTable[i]);
+
+  if (frac == 0)
+    return v0;
+  int16_t v1 = pgm_read_word(&sinTable[i + 1]);
+  return v0 + (int16_t)((((int32_t)(v1 - v0) * frac * 6554) + 32768) >> 16);
+}
+
+int16_t windSin(int16_t tenths)
+{
+  uint16_t a = windNormalize(tenths);
+
+  if (a <= 900)
+    return quarterSin(a);
+  if (a <= 1800)
+    return quarterSin(1800 - a);
+  if (a <= 2700)
+    return -quarterSin(a - 1800);
+  return -quarterSin(3600 - a);
+}
+
+int16_t windCos(int16_t tenths)
+{
+  return windSin(windNormalize(tenths) + 900);
+}
+
+int16_t windAtan2(int32_t y, int32_t x)
+{
+  uint32_t ay = y < 0 ? -y : y;
+  uint32_t ax = x < 0 ? -x : x;
+  uint32_t lo = ay < ax ? ay : ax;
+  uint32_t hi = ay < ax ? ax : ay;
+  uint16_t ratio;
+  uint8_t i, frac;
+  int16_t a, v0, v1;
+
+  if (hi == 0)
+    return 0;
+  // keep lo << 12 within 32 bits
+  while (hi >= (1UL << 19))
+  {
+    hi >>= 1;
+    lo >>= 1;
+  }
+  ratio = (lo << 12) / hi; // tan of the angle to the nearest axis, Q12
+  i = ratio >> 6;
+  frac = ratio & 63;
+  v0 = pgm_read_word(&atanTable[i]);
+  v1 = i < 64 ? pgm_read_word(&atanTable[i + 1]) : v0;
+  a = windUnits(v0 + (((v1 - v0) * frac + 32) >> 6)); // 0.01 -> 0.1 deg
+
+  if (ay > ax)
+    a = 900 - a;
+  if (x < 0)
+    a = 1800 - a;
+  if (y < 0)
+    a = 3600 - a;
+  return a >= 3600 ? a - 3600 : a;
+}
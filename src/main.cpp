@@ -39,9 +39,14 @@
             Source: https://gpsd.gitlab.io/gpsd/NMEA.html#_nmea_0183_physical_protocol_layer
 
 
-        2)  Rx1 and TX1 are reserved for the display communication 38400Bd
-            Digital pin 10 (and 11) are reserved for NMEA talker via
-            SoftSerial on 38400 Bd
+        2)  Rx1 and TX1 are reserved for the display communication; nexInit()
+            negotiates the fastest baudrate in NEX_BAUD_RATES (NexConfig.h)
+            Digital pin 10 is reserved for the NMEA talker via the interrupt
+            driven NMEASerial receiver (Timer2 + pin-change interrupt), which
+            runs at NMEA_BAUD up to 38400 Bd
+            Digital pin 9 is reserved for the NMEA listener down the chain,
+            served by the interrupt driven NMEARelay transmitter (Timer1)
+            when WRITE_ENABLED is defined
   
   Hardware setup:
   The Arduino Nano V3 has only 1 Rx/Tx port so in NexConfig.h the DEBUG_SERIAL_ENABLE 
@@ -50,7 +55,7 @@
   Wiring Diagram (for NMEA0183 to NMEA0183 device):
   Arduino   | NMEA device
      Pin 10 |  RX +   
-     Pin 11 |  TX + 
+     Pin 9  |  TX + 
   
   Set the pins to the correct one for your development shield or breakout board.
   This program uses these data lines to the Nextion 3,5" Enhanced LCD,
@@ -77,30 +82,56 @@
   Do NOT use this compass in situations involving safety to life
   such as navigation at sea.  
         
-  TO DO:    Implement 2-way communication so that incomming NMEA data can be relayed
-            to other devices. An NMEA0183 network is typically a daisy chained network
-
   LIMITATIONS: 
-            No relay of NMEA0183 data possible currently. So display needs to be
-            implemented as the last node in the daisy chain.
+            An NMEA0183 network is typically a daisy chained network. Without
+            WRITE_ENABLED the display needs to be the last node in the chain,
+            with it only the sentences the display decodes are passed on.
  
   Credit:   
 */
 
 //*** Include the Nextion Display files here
 #include <Nextion.h> //All other Nextion classes come with this libray
-
-//*** Since the Arduino Nano V3 has only one Rx/Tx port we need SoftwareSerial to
-//*** setup the serial communciation with the NMEA0183 network
-#include <SoftwareSerial.h>
+#include <NMEAParser.h>
+#include <NMEAQueue.h>
+#include <WindState.h>
+#include <WindFilter.h>
+#include <TrueWind.h>
+#include <LoopStats.h>
+#include <LatencyHistogram.h>
+#include <BitRegister.h>
+#include <RefreshScheduler.h>
+
+//*** Since the Arduino Nano V3 has only one Rx/Tx port we need an interrupt
+//*** driven software receiver to setup the communciation with the NMEA0183 network
+#include <NMEASerial.h>
+#include <NMEARelay.h>
+#include <NMEARelayPolicy.h>
 
 //*** Definitions goes here
 
-//For testing  and development purposes only outcomment to disable
+//*** Relays every received sentence on pin 9, so the display can sit halfway
+// a daisy chain; uncomment to enable
 //#define WRITE_ENABLED 1
 
 #define NMEA_BAUD 4800      //baudrate for NMEA communciation
-#define NMEA_BUFFER_SIZE 83 // According NEA0183 specs the max char is 82 + '\0'
+#define NMEA_BYTE_US (10000000UL / NMEA_BAUD) // us per byte on the line
+#define RELAY_BUDGET 80     // % of the line downstream the relay may fill
+
+//*** Sentences to decode; outcomment to leave the decoder out of the firmware
+#define DECODE_VWR 1 // aparent wind angle and speed
+#define DECODE_MWV 1 // wind angle and speed (relative only)
+#define DECODE_RMC 1 // speed and course over ground
+#if !defined(DECODE_VWR) && !defined(DECODE_MWV) && !defined(DECODE_RMC)
+#error "At least one DECODE_ sentence must be defined"
+#endif
+
+//*** Damping time constants in ms to steady the display; 0 shows the raw
+// values. Angles are averaged as vectors, so 359 and 1 give 0 and not 180
+#define DAMPING_AWA 1000
+#define DAMPING_AWS 1000
+#define DAMPING_SOG 2000
+#define DAMPING_COG 2000
 
 #define RED 63488  //Nextion color
 #define GREEN 2016 //Nextion color
@@ -115,7 +146,6 @@
 #define WINDDISPLAY_STATUS "status"
 #define INDICATOR_PORT ">>>"
 #define INDICATOR_STARBOARD "<<<"
-#define FIELD_BUFFER 15 //nr of char used for displaying info on Nextion
 
 enum displayItems
 {
@@ -131,15 +161,29 @@ enum displayItems
 //*** Global scope variable declaration goes here
 NexPicture dispStatus = NexPicture(0, 16, WINDDISPLAY_STATUS);
 
-SoftwareSerial nmeaSerial = SoftwareSerial(10, 11, true); //
+NMEASerial nmeaSerial; // inverted input on NMEA_RX_PIN (10)
+
+WindState wind = {}; // single source of truth for the decoded wind and course
+WindAngleFilter awaFilter(DAMPING_AWA);
+WindScalarFilter awsFilter(DAMPING_AWS);
+WindScalarFilter sogFilter(DAMPING_SOG);
+WindAngleFilter cogFilter(DAMPING_COG);
+TrueWindInput trueWindInput = {}; // inputs of the last true wind computation
+//*** Layout of the 32-bit sys2 register in the HMI, see displayData()
+typedef BitField<0, 6> Sys2AWS;  // 0..63 kts
+typedef BitField<6, 6> Sys2SOG;  // 0..63 kts
+typedef BitField<12, 9> Sys2AWA; // 0..359 deg, 181..359 is port
+typedef BitField<21, 9> Sys2COG; // 0..359 deg
+typedef BitRegister<Sys2AWS, Sys2SOG, Sys2AWA, Sys2COG> Sys2;
+static_assert(bitFieldRoundTrips<Sys2AWS>(0, Sys2AWS::max) &&
+                  bitFieldRoundTrips<Sys2SOG>(0, Sys2SOG::max) &&
+                  bitFieldRoundTrips<Sys2AWA>(0, Sys2AWA::max) &&
+                  bitFieldRoundTrips<Sys2COG>(0, Sys2COG::max),
+              "sys2 fields do not round-trip");
 
-char _AWA[FIELD_BUFFER] = {0};
-char _COG[FIELD_BUFFER] = {0};
-char _SOG[FIELD_BUFFER] = {0};
-char _AWS[FIELD_BUFFER] = {0};
-char _DIR[FIELD_BUFFER] = {0};
 long _BITVAL = 0L; //32-bit register to communicate with Nextion
 long oldVal = 0L;  // holds previos _BITVALUE to check if we need to send
+bool frameFailed = false; // true when the last sys2 update was not acknowledged
 
 enum nextionStatus
 {
@@ -148,21 +192,62 @@ enum nextionStatus
   HMI_READY = 5
 };
 
-String sentence;
-char cvalue[FIELD_BUFFER] = {0};
-uint16_t tmpVal = 0;
-
-unsigned int ci = 0; // current index of ',' to iterate through received NMEA data
-unsigned int li = 0; // last index of ',' in NMEA buffer
-uint16_t cp = 0;     //current index pointer in an array
-int field = 0;
 bool updateDisplay = false;
 
-const byte numChars = NMEA_BUFFER_SIZE;
-char receivedChars[numChars];
+// received sentences waiting to be parsed; the receiver keeps going while
+// earlier sentences are still pending
+NMEAQueue nmeaQueue;
+
+//*** Nextion display timer max speed is 50ms so there is no need to send
+// faster; sending is paced to what the HMI acknowledges
+#define DISPLAY_MIN_INTERVAL 50   // ms
+#define DISPLAY_MAX_INTERVAL 1000 // ms
+RefreshScheduler refresh(DISPLAY_MIN_INTERVAL, DISPLAY_MAX_INTERVAL);
+
+//*** Without success replies (bkcmd=2) a sendme follows a sys2 frame now
+// and then; its reply is the only round trip the scheduler can measure
+#define DISPLAY_PROBE_INTERVAL 1000 // ms
+uint32_t probeSent = 0;             // millis() of the last probe
+bool frameProbed = false;           // a probe follows the sys2 frame in flight
+
+//*** Age of the data on screen, from the '$' of the newest sentence in a
+// sys2 frame until the HMI replied to the frame, or under bkcmd=2 to the
+// probe after it; dumped over the debug serial
+#define LATENCY_DUMP_INTERVAL 60000 // ms
+LatencyHistogram frameLatency = {};
+uint32_t frameStamp = 0; // wind.stamp of the sys2 frame in flight
+
+/* called by nexPoll() with the outcome of a sys2 update; a frame the HMI
+ * rejected is sent again. A frame that was only acknowledged late did
+ * arrive, so it is not repeated; that would only load a slow HMI more.
+ * Without success replies (bkcmd=2) a frame is acknowledged by the lack
+ * of an error within NEX_CMD_TIMEOUT; that wait is no part of its age and
+ * says nothing of the link, so it is left out of both. A probed frame is
+ * timed and fed back to the scheduler by onFrameProbe() instead.
+*/
+void onFrameAck(uint8_t status, void *)
+{
+  bool replied = nexResponseMode() & NEX_BKCMD_SUCCESS;
+
+  if (status != NEX_ACK_OK && status != NEX_ACK_TIMEOUT)
+    frameFailed = true;
+  if (replied && status == NEX_ACK_OK && frameStamp != 0)
+    latencyRecord(&frameLatency, micros() - frameStamp);
+  if (!frameProbed)
+    refresh.done(millis(), status == NEX_ACK_OK, replied);
+}
 
-bool newData = false;
-unsigned long tmr1 = 0;
+/* called by nexPoll() with the reply to the sendme after a sys2 frame; it
+ * comes after the frame is handled, so it times the whole round trip and a
+ * slow HMI makes the scheduler back off as it does with success replies
+*/
+void onFrameProbe(uint8_t status, void *)
+{
+  frameProbed = false;
+  if (status == NEX_ACK_OK && !frameFailed && frameStamp != 0)
+    latencyRecord(&frameLatency, micros() - frameStamp);
+  refresh.done(millis(), status == NEX_ACK_OK && !frameFailed, true);
+}
 
 /* Display wind data onto the nextion HMI
    the 4 parameters aws,sog,awa and cog are encode in a 32bit value
@@ -171,7 +256,7 @@ unsigned long tmr1 = 0;
    awa bit 12-20 meaning max value of 512 degrees, only need 360 though
    cog bit 21-29 meanig max valie of 512 degrees, only need 360 though
    2 most significant bits (30-31) are reserved and currently not used
-   we shift << the bits from cog,awa,sog and aws respectively so all bits are in place
+   the layout is declared once as Sys2, which packs all 4 values in one go
 
    The wind angle is typically represented between 0 - 180 degrees Port(-) or Starboard(+) 
    and indicated by a color red(Port) or green(Starboard) and/or in indicator >,<,R,L 
@@ -187,64 +272,68 @@ unsigned long tmr1 = 0;
  */
 /*** Converts and adjusts the incomming values to usable values for the HMI display 
  * and shifts these integer(!) values into the 32-bit register and sends the
- * 32-bit register to the Nextion HMI in timed intervals of 50ms.
+ * 32-bit register to the Nextion HMI when the refresh scheduler has a token.
+ * The update is only queued; nexPoll() sends it and tracks the reply.
  * This is due the fact that a timer in the HMI checks on new dat and refreshes the 
  * display. So no need to send more data than you can chew!
- * A refresh of 20x per second is more then sufficient.
+ * A refresh of 20x per second is more then sufficient, a change after a quiet
+ * spell goes out at once and a slow HMI makes the scheduler back off.
  */
 void displayData()
 {
-  long intValue = 0L;
-
-  // set most significant value; cog
-  intValue = atoi(_COG);
-  // values in degrees can not be bigger than 360
-  intValue = (long)(intValue % 360);
-  _BITVAL = (long)intValue; // put value cog in register
-  _BITVAL = _BITVAL << 9;   // and shift left 9 bits making room for the next 9 bits
-  //set awa
-  intValue = atoi(_AWA);
-  if (intValue < -180)
-    intValue *= -1; // the register has no place for signed integers
-  else
-    intValue += 360;
-  intValue = (long)(intValue % 360); // convert values <0; i.e. -179 -> 181
-  _BITVAL ^= (long)intValue;         // XOR add value to register
-  _BITVAL = _BITVAL << 6;            // and shift left 6 bits to make room for sog
-
-  //set sog
-  intValue = atoi(_SOG);
-  if (intValue < 0 || intValue > 63) // test for invalid values
-    intValue = (oldVal >> 6) & 63;   //0L; // use previos if true to prevent jumping values
-  _BITVAL ^= (long)intValue;         // XOR the value into register
-  _BITVAL = _BITVAL << 6;            // ans shift left 6 bits for final value of aws
-
-  // set aws
-  intValue = atoi(_AWS);
-  if (intValue < 0 || intValue > 63) // test for invalid values
-    intValue = oldVal & 63;          //0L; // use previos if true to prevent jumping values
-  _BITVAL ^= (long)intValue;
-
-  //*** Nextion display timer max speed is 50ms
-  // so no need to send faster than 50ms otherwise
-  // flooding the serialbuffer
-  if (millis() - tmr1 > 50)
+  uint16_t cog, awa, sog, aws;
+  int16_t intValue;
+
+  // use the previous value on an invalid one to prevent jumping values
+  cog = Sys2COG::unpack(oldVal);
+  if (wind.cog.valid)
+  {
+    intValue = windUnits(wind.cog.value);
+    // values in degrees can not be bigger than 360
+    cog = intValue >= 360 ? intValue - 360 : intValue;
+  }
+
+  awa = Sys2AWA::unpack(oldVal);
+  if (wind.awa.valid)
   {
-    tmr1 = millis();
-    if (oldVal != _BITVAL)
+    intValue = windUnits(wind.awa.value);
+    // the register has no place for signed integers; i.e. -179 -> 181
+    awa = intValue < 0 ? intValue + 360 : (intValue >= 360 ? intValue - 360 : intValue);
+  }
+
+  sog = Sys2SOG::unpack(oldVal);
+  intValue = windUnits(wind.sog.value);
+  if (wind.sog.valid && intValue >= 0 && intValue <= (int16_t)Sys2SOG::max)
+    sog = intValue;
+
+  aws = Sys2AWS::unpack(oldVal);
+  intValue = windUnits(wind.aws.value);
+  if (wind.aws.valid && intValue >= 0 && intValue <= (int16_t)Sys2AWS::max)
+    aws = intValue;
+
+  _BITVAL = Sys2::pack(aws, sog, awa, cog);
+
+  // only queue a new frame when the previous one is done, so the HMI
+  // always gets the latest values and the loop never waits for a reply
+  if ((oldVal != _BITVAL || frameFailed) && nexPending() == 0 && refresh.ready(millis()))
+  {
+    char cmd[16] = "sys2=";
+
+    oldVal = _BITVAL;
+    frameStamp = wind.stamp;
+    frameFailed = false;
+    ltoa(_BITVAL, cmd + 5, 10);
+    // clear the previous databuffer if present; without success replies
+    // nothing waits for it and it would race sys2 in the HMI buffer
+    if (nexResponseMode() & NEX_BKCMD_SUCCESS)
+      nexQueueCommand("code_c");
+    nexQueueCommand(cmd, onFrameAck);
+    if (nexResponseMode() == NEX_BKCMD_ERRORS && millis() - probeSent >= DISPLAY_PROBE_INTERVAL)
     {
-      oldVal = _BITVAL;
-      sendCommand("code_c");     // clear the previous databuffer if present
-      recvRetCommandFinished(5); // always wait for a reply from the HMI!
-
-      nexSerial.print("sys2=");
-      nexSerial.print((long)_BITVAL);
-      nexSerial.write(0xFF);
-      nexSerial.write(0xFF);
-      nexSerial.write(0xFF);
-      recvRetCommandFinished(5);
+      probeSent = millis();
+      frameProbed = nexQueueCommand("sendme", onFrameProbe);
     }
-    newData = false;
+    refresh.sent(millis());
   }
 }
 
@@ -255,6 +344,7 @@ void displayData()
 void hmiCommtest(uint16_t t0)
 {
   int dir = 0;
+  uint32_t now = millis();
   for (int i = t0; i < 360; i += 90)
   {
     if (i <= 180)
@@ -263,190 +353,397 @@ void hmiCommtest(uint16_t t0)
     }
     else
       dir = i - 360;
-    itoa(i, _COG, FIELD_BUFFER);
-    itoa(dir, _AWA, FIELD_BUFFER);
-    itoa(i / 3, _SOG, FIELD_BUFFER);
-    itoa(i / 3, _AWS, FIELD_BUFFER);
+    windSet(&wind.cog, i * 10, now);
+    windSet(&wind.awa, dir * 10, now);
+    windSet(&wind.sog, i / 3 * 10, now);
+    windSet(&wind.aws, i / 3 * 10, now);
     displayData();
+    while (nexPending() > 0)
+      nexPoll();
     delay(250);
   }
 
   dispStatus.setPic(HMI_READY);
 }
 
+
+/* stores the aparent wind angle and speed of a VWR or MWV sentence; both
+ * have the angle in field 1, the side or reference in field 2 and the speed
+ * in knots in field 3. The angle is stored as -180..180, negative for port.
+ * Both are damped before they are stored. Returns true when either got a
+ * new value.
+*/
+bool storeApparentWind(const NMEASentence *nmea)
+{
+  uint32_t now = millis();
+  int32_t value;
+  bool updated = false;
+
+  if (nmeaFieldFixed(nmea, 1, 1, &value) && value >= 0 && value < 3600)
+  {
+    if (value > 1800)
+      value -= 3600; // MWV gives 0..359 clockwise from the bow
+    if (nmeaFieldLen(nmea, 2) == 1 && nmeaField(nmea, 2)[0] == 'L')
+      value = -value; // VWR gives 0..180 left or right of the bow
+    value = windFilter(&awaFilter, value, now);
+    windSet(&wind.awa, value > 1800 ? value - 3600 : value, now);
+    updated = true;
+  }
+  else
+    windInvalidate(&wind.awa, now);
+
+  if (nmeaFieldFixed(nmea, 3, 1, &value) && value >= 0 && value <= WIND_VALUE_MAX)
+  {
+    windSet(&wind.aws, windFilter(&awsFilter, value, now), now);
+    updated = true;
+  }
+  else
+    windInvalidate(&wind.aws, now);
+  return updated;
+}
+
+#ifdef DECODE_VWR
+/* decodes the aparent wind angle and speed from a VWR sentence
+ * $--VWR,<angle 0-180>,<L/R>,<speed kts>,N,<speed m/s>,M,<speed km/h>,K*hh
+*/
+bool decodeVWR(const NMEASentence *nmea)
+{
+  return storeApparentWind(nmea);
+}
+#endif
+
+#ifdef DECODE_MWV
+/* decodes the wind angle and speed from a MWV sentence, but only when
+ * it is the relative (aparent) wind in knots and flagged valid
+ * $--MWV,<angle 0-359>,<R/T>,<speed>,<unit>,<status>*hh
+*/
+bool decodeMWV(const NMEASentence *nmea)
+{
+  if (nmeaFieldLen(nmea, 2) == 1 && nmeaField(nmea, 2)[0] == 'R' &&
+      nmeaFieldLen(nmea, 4) == 1 && nmeaField(nmea, 4)[0] == 'N')
+  {
+    if (nmeaFieldLen(nmea, 5) == 1 && nmeaField(nmea, 5)[0] == 'A')
+      return storeApparentWind(nmea);
+    windInvalidate(&wind.awa, millis());
+    windInvalidate(&wind.aws, millis());
+  }
+  return false;
+}
+#endif
+
+#ifdef DECODE_RMC
+/* decodes the speed and course over ground from a RMC sentence
+ * $--RMC,<time>,<status>,<lat>,<N/S>,<lon>,<E/W>,<sog>,<cog>,<date>,...*hh
+*/
+bool decodeRMC(const NMEASentence *nmea)
+{
+  uint32_t now = millis();
+  bool fix = nmeaFieldLen(nmea, 2) == 1 && nmeaField(nmea, 2)[0] == 'A';
+  bool updated = false;
+  int32_t value;
+
+  if (fix && nmeaFieldFixed(nmea, 7, 1, &value) && value >= 0 && value <= WIND_VALUE_MAX)
+  {
+    windSet(&wind.sog, windFilter(&sogFilter, value, now), now);
+    updated = true;
+  }
+  else
+    windInvalidate(&wind.sog, now);
+
+  if (fix && nmeaFieldFixed(nmea, 8, 1, &value) && value >= 0 && value <= 3600)
+  {
+    windSet(&wind.cog, windFilter(&cogFilter, value, now), now);
+    updated = true;
+  }
+  else
+    windInvalidate(&wind.cog, now);
+  return updated;
+}
+#endif
+
+//*** Sentences we decode, keyed on the sentence id in field 0. A decoder is
+// only linked into the firmware when its DECODE_ definition is set.
+const NMEADispatch nmeaDecoders[] = {
+#ifdef DECODE_VWR
+    {NMEA_SENTENCE_ID('V', 'W', 'R'), decodeVWR},
+#endif
+#ifdef DECODE_MWV
+    {NMEA_SENTENCE_ID('M', 'W', 'V'), decodeMWV},
+#endif
+#ifdef DECODE_RMC
+    {NMEA_SENTENCE_ID('R', 'M', 'C'), decodeRMC},
+#endif
+};
+const uint8_t numDecoders = sizeof(nmeaDecoders) / sizeof(nmeaDecoders[0]);
+
+/* returns the index in checksumErrors for a sentence; the decoded types have
+ * their own counter, all other sentences share the last one
+*/
+uint8_t checksumIndex(const char *sentence)
+{
+  int8_t i = nmeaLookup(nmeaTagId(sentence), nmeaDecoders, numDecoders);
+  return i < 0 ? numDecoders : i;
+}
+
+//*** Nr of sentences dropped on a bad or missing checksum, per decoded type
+uint16_t checksumErrors[numDecoders + 1] = {0};
+
+//*** Nr of sentences skipped after their tag since nobody wants them
+uint16_t sentencesSkipped = 0;
+
 #ifdef WRITE_ENABLED
-/** actualy writes nmea data to digital pin 9 as a additional serial port while
- * inverting the data from TTL-level to RS-232 level
- * 
- * TO DO: find the correct dely time for correct data transmission; still
- * missing the first 3-4 characters
- * */
-void nmeaOut(char data)
+NMEARelay nmeaRelay; // inverted output on NMEA_TX_PIN (9)
+
+/* builds the relay report $PYAZR,<forwarded>,<shed>,<overruns> to let the
+ * listeners downstream know what they miss
+*/
+uint8_t relayReport(char *buf, uint8_t size);
+
+#ifdef LOOP_STATS_ENABLED
+/* builds the loop counters $PYAZC,<rx high water>,<rx overflows>,
+ * <framing errors>,<queue high water>,<queue dropped>,<ack timeouts>
+*/
+uint8_t loopCounters(char *buf, uint8_t size);
+#endif
+
+//*** What is passed on downstream, per talker and sentence id; the 1st match
+// applies. The wind and course we decode go as they come, the GPS is thinned
+// out and the satellites in view, half the traffic of a typical bus, stay here
+NMEARelayRule relayRules[] = {
+    {"--VWR", NMEA_RELAY_PASS},
+    {"--MWV", NMEA_RELAY_PASS},
+    {"--RMC", NMEA_RELAY_PASS},
+    {"--DBT", NMEA_RELAY_HZ(1)},
+    {"--GGA", NMEA_RELAY_HZ(1)},
+    {"--VLW", 5000},
+    {"--MTW", 5000},
+    {"--XDR", 5000},
+    {"AIVDM", NMEA_RELAY_PASS},
+    {"--GSA", NMEA_RELAY_DROP},
+    {"--GSV", NMEA_RELAY_DROP},
+    {"PYAZR", 10000, relayReport},
+#ifdef LOOP_STATS_ENABLED
+    {"PYAZT", 2000, loopStatsSentence},
+    {"PYAZC", 10000, loopCounters},
+#endif
+    {"-----", NMEA_RELAY_DROP},
+};
+NMEARelayPolicy relayPolicy(relayRules, sizeof(relayRules) / sizeof(relayRules[0]));
+
+uint8_t relayReport(char *buf, uint8_t size)
+{
+  uint8_t len = 0;
+
+  if (size < 24) // "$PYAZR" + 3 * ",65535"
+    return 0;
+  strcpy(buf, "$PYAZR");
+  len = 6;
+  buf[len++] = ',';
+  len += strlen(ultoa(relayPolicy.forwarded(), buf + len, 10));
+  buf[len++] = ',';
+  len += strlen(ultoa(relayPolicy.shed(), buf + len, 10));
+  buf[len++] = ',';
+  len += strlen(ultoa(nmeaRelay.overruns(), buf + len, 10));
+  return len;
+}
+
+#ifdef LOOP_STATS_ENABLED
+uint8_t loopCounters(char *buf, uint8_t size)
 {
-  byte mask;
-  //startbit
-  digitalWrite(9, HIGH);
-  delayMicroseconds(200);
-  for (mask = 0x01; mask > 0; mask <<= 1)
+  uint16_t values[] = {loopStatsRxHighWater(), nmeaSerial.overflows(),
+                       nmeaSerial.framingErrors(), nmeaQueue.highWater(),
+                       nmeaQueue.dropped(), nexLinkStats()->timeouts};
+  uint8_t len;
+
+  if (size < 42) // "$PYAZC" + 6 * ",65535"
+    return 0;
+  strcpy(buf, "$PYAZC");
+  len = 6;
+  for (uint8_t i = 0; i < sizeof(values) / sizeof(values[0]); i++)
   {
-    if (data & mask)
-    {                       // choose bit
-      digitalWrite(9, LOW); // send 1
-    }
-    else
-    {
-      digitalWrite(9, HIGH); // send 0
-    }
-    delayMicroseconds(200);
+    buf[len++] = ',';
+    len += strlen(utoa(values[i], buf + len, 10));
   }
-  //stop bit
-  digitalWrite(9, LOW);
-  delayMicroseconds(200);
+  return len;
 }
 #endif
 
-/** reads the softseroal port pin 10 and ckeks for valid nmea data starting with
- * character '$' only (~ and ! can be skipped as start charcter)
+/* relays a sentence straight from its slot in the queue when the policy
+ * lets it through; the slot is held until the relay has sent it, so the
+ * receiver cannot overwrite it halfway
+*/
+void relayData(const char *sentence, uint8_t len)
+{
+  if (relayPolicy.admit(sentence, len, millis()) && nmeaRelay.send(sentence, len, true))
+    nmeaQueue.hold();
+  else
+    nmeaQueue.pop();
+}
+
+/* sends the sentence of our own that is due, if any; its buffer is only
+ * refilled once the previous one has left
+*/
+void relayInject()
+{
+  static char injected[48];
+  uint8_t len;
+
+  if (nmeaRelay.sending(injected))
+    return;
+  len = relayPolicy.inject(millis(), injected, sizeof(injected));
+  if (len > 0)
+    nmeaRelay.send(injected, len, false);
+}
+#endif
+
+/* decides on the tag in the first 6 characters ($ + talker id + sentence id)
+ * and the character that follows it if the sentence should be received at all.
+ * The allow-list is the set of sentence types with a decoder, so enabling a
+ * DECODE_ definition also lets its sentences through, plus what the relay
+ * policy passes on.
+*/
+bool sentenceWanted(const char *tag, char next)
+{
+  if (next != ',')
+    return false;
+#ifdef WRITE_ENABLED
+  if (relayPolicy.wanted(tag, millis()))
+    return true;
+#endif
+  return tag[0] == '$' && tag[1] != 'P' &&
+         nmeaLookup(NMEA_SENTENCE_ID(tag[3], tag[4], tag[5]),
+                    nmeaDecoders, numDecoders) >= 0;
+}
+
+/** reads the nmea input on pin 10 and ckeks for valid nmea data starting with
+ * character '$', or '!' for the AIS sentences the relay may pass on
+ * The checksum is calculated while the characters come in, so when the end
+ * marker arrives we know right away if the sentence is corrupt. Corrupt
+ * sentences and sentences without checksum are dropped and counted per type.
+ * Sentences we have no use for are rejected as soon as their tag is known,
+ * without buffering the rest of the line.
 */
 void recvNMEAData()
 {
   static bool recvInProgress = false;
   static byte ndx = 0;
+  static char *receivedChars = nmeaQueue.receiveSlot();
+  static byte checksum = 0;     // XOR of all characters between '$' and '*'
+  static byte csReceived = 0;   // checksum as sent by the talker
+  static int8_t csDigits = -1;  // nr of checksum digits received, -1 before '*'
+  static uint32_t stamp = 0;    // micros() the start marker arrived
   char startMarker = '$';
+  char aisMarker = '!';
   char endMarker = '\n';
   char rc;
+  int8_t nibble;
 
-  while (nmeaSerial.available() > 0 && newData == false)
+  while (nmeaSerial.available() > 0)
   {
     rc = nmeaSerial.read();
 
-    if (recvInProgress == true)
+    if (rc == startMarker || rc == aisMarker)
     {
-      if (rc != endMarker)
+      // (re)start; a '$' halfway a sentence means we lost its end
+      receivedChars = nmeaQueue.receiveSlot();
+      // the bytes behind it in the receive buffer came in after it
+      stamp = micros() - nmeaSerial.available() * NMEA_BYTE_US;
+      receivedChars[0] = rc;
+      ndx = 1;
+      checksum = 0;
+      csReceived = 0;
+      csDigits = -1;
+      recvInProgress = true;
+    }
+    else if (recvInProgress == true)
+    {
+      if (ndx == 6 && !sentenceWanted(receivedChars, rc))
+      {
+        // not for us; ignore everything up to the next start marker
+        recvInProgress = false;
+        sentencesSkipped++;
+      }
+      else if (rc != endMarker)
       {
+        if (csDigits < 0)
+        {
+          if (rc == '*')
+            csDigits = 0;
+          else
+            checksum ^= rc;
+        }
+        else if (csDigits < 2)
+        {
+          nibble = nmeaHexValue(rc);
+          if (nibble < 0)
+            csDigits = 3; // not a hex digit, so never valid
+          else
+          {
+            csReceived = (csReceived << 4) | nibble;
+            csDigits++;
+          }
+        }
         receivedChars[ndx] = rc;
         ndx++;
-        if (ndx >= numChars)
+        if (ndx >= NMEA_BUFFER_SIZE)
         {
-          ndx = numChars - 1;
+          ndx = NMEA_BUFFER_SIZE - 1;
         }
       }
       else
       {
+        // keep the line as it came in, so it can be relayed from the slot
+        if (ndx < NMEA_BUFFER_SIZE - 1)
+          receivedChars[ndx++] = rc;
         receivedChars[ndx] = '\0'; // terminate the string
 
         recvInProgress = false;
+        if (csDigits == 2 && csReceived == checksum)
+          nmeaQueue.commit(ndx, stamp); // counts the sentence as dropped when full
+        else
+          checksumErrors[checksumIndex(receivedChars)]++;
         ndx = 0;
-        newData = true;
       }
     }
-
-    else if (rc == startMarker)
-    {
-      receivedChars[ndx] = rc;
-      ndx++;
-      recvInProgress = true;
-    }
   }
 }
 
-/* only processes the receivedChars buffer and filters sentence MWV,RM and VWR,
- * which contain the SOG,COG, AWS and AWA parameters, when new data has arrived
+/* processes the sentences waiting in the receive queue and hands each of them
+ * to the decoder registered for its sentence id.
+ * The sentences are tokenized in place in a single pass.
 */
 void processNMEAData()
 {
-  if (newData == true)
-  {
-
-    sentence = String(receivedChars);
-
-    //cvalue='\0';
-    tmpVal = 0;
-
-    ci = sentence.indexOf(',', 0);
-    li = sentence.indexOf(',', ci + 1);
-    cp = 0;
+  const char *sentence;
+  NMEASentence nmea;
 
-    if (sentence.indexOf("MWV", 0) > 0 ||
-        sentence.indexOf("RMC") > 0 ||
-        sentence.indexOf("VWR") > 0)
-    {
-      field = 0; //ignore sentence tag
-      while (li < sentence.length() && li < numChars)
-      {
-
-        cp = 0;
-        while (ci + 1 < li)
-        {
-          cvalue[cp++] = sentence[ci + 1];
-          ci++;
-        }
-        cvalue[cp] = '\0';
-        field++;
-        // only check for aparent or relaive wind directions and speed
-        if ((sentence.indexOf("MWV") > 0 && sentence.indexOf(",R,") > 0) ||
-            sentence.indexOf("VWR") > 0)
-        {
-          if (field == 1)
-          {
-            memcpy(_AWA, cvalue, FIELD_BUFFER - 1);
-          }
-          if (field == 2)
-          {
-            memcpy(_DIR, cvalue, FIELD_BUFFER - 1);
-            if (_DIR[0] == 'L' || _DIR[0] == 'T')
-            {
-              memmove(_AWA + 1, _AWA, FIELD_BUFFER - 2);
-              _AWA[0] = '-';
-            }
-          }
-          if (field == 3)
-          {
-            memcpy(_AWS, cvalue, FIELD_BUFFER - 1);
-          }
-        }
-
-        if (sentence.indexOf("RMC") > 0)
-        {
-          if (field == 7)
-          {
-            memcpy(_SOG, cvalue, FIELD_BUFFER - 1);
-          }
-          if (field == 8)
-          {
-            memcpy(_COG, cvalue, FIELD_BUFFER - 1);
-          }
-        }
-        ci = li;
-        li = sentence.indexOf(',', ci + 1);
-        if (li < 0 || li > numChars)
-          li = sentence.length();
-      }
-    }
-  }
-}
-
-#ifdef WRITE_ENABLED
-// writes nmea data over digital pin as an additional serial port
-void relayData()
-{
-  uint16_t i = 0;
-  while (receivedChars[i] != '0')
+  while ((sentence = nmeaQueue.front()) != NULL)
   {
-    nmeaOut(receivedChars[i]);
-
-    i++;
+    nmeaTokenize(sentence, &nmea);
+    // the age on screen is that of the newest value, not of the newest
+    // sentence a decoder looked at
+    if (nmeaDispatch(&nmea, nmeaDecoders, numDecoders))
+      wind.stamp = nmeaQueue.frontStamp();
+#ifdef WRITE_ENABLED
+    relayData(sentence, nmeaQueue.frontLength());
+#else
+    nmeaQueue.pop();
+#endif
   }
-}
+#ifdef WRITE_ENABLED
+  // free the slots the relay is done with
+  for (uint8_t n = nmeaRelay.reclaim(); n > 0; n--)
+    nmeaQueue.release();
+  relayInject();
 #endif
+  // only recomputed when one of the decoded values changed
+  trueWindUpdate(&trueWindInput, &wind, millis());
+}
 
 void setup()
 {
 //Initialize the Nextion Display; the display will run a "selftest" and takes
 // about 15 seconds to finish
-#ifdef WRITE_ENABLED
-  pinMode(9, OUTPUT);
-#endif
   nexInit();
 
   delay(1500);
@@ -460,24 +757,44 @@ void setup()
     dispStatus.getPic(&displayReady);
     delay(100);
   }
+  // from here on the HMI only answers when something went wrong, which
+  // halves the traffic on the line for every sys2 frame
+  nexSetResponseMode(NEX_BKCMD_ERRORS);
+  refresh.begin(millis(), nexLatency());
   hmiCommtest(45);
   // restet the HMI o default 0 values
-  memcpy(_AWA, "0", 2);
-  memcpy(_COG, "0", 2);
-  memcpy(_SOG, "0", 2);
-  memcpy(_AWS, "0", 2);
+  windSet(&wind.awa, 0, millis());
+  windSet(&wind.cog, 0, millis());
+  windSet(&wind.sog, 0, millis());
+  windSet(&wind.aws, 0, millis());
   displayData();
 
   pinMode(10, INPUT_PULLUP);
   nmeaSerial.begin(NMEA_BAUD);
+#ifdef WRITE_ENABLED
+  nmeaRelay.begin(NMEA_BAUD);
+  relayPolicy.begin(NMEA_BAUD, RELAY_BUDGET, millis());
+#endif
 }
 
 void loop()
 {
+  LOOP_STATS_BEGIN(nmeaSerial.available());
   recvNMEAData();
+  LOOP_STATS_STAGE(STAGE_RECEIVE);
   processNMEAData();
+  LOOP_STATS_STAGE(STAGE_PARSE);
   displayData();
-#ifdef WRITE_ENABLED
-  relayData();
+  LOOP_STATS_STAGE(STAGE_DISPLAY);
+  nexPoll();
+  LOOP_STATS_STAGE(STAGE_POLL);
+
+#ifdef DEBUG_SERIAL_ENABLE
+  static uint32_t latencyDumped = 0;
+  if (millis() - latencyDumped >= LATENCY_DUMP_INTERVAL)
+  {
+    latencyDumped = millis();
+    latencyDump(&frameLatency);
+  }
 #endif
 }